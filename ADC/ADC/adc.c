@@ -7,22 +7,375 @@
 
 #include "adc.h"
 
+volatile uint8_t adc_mode= ADC_MODE_SINGLE;	//Current operating mode.
+uint8_t adc_prescaler= ADC_PRESCALER_128;		//Prescaler of the 10 bit profile (set by 'adc_set').
+uint8_t adc_reference= ADC_AREF_EXTERNAL;		//Reference of channels without reference bits (set by 'adc_set').
+uint8_t adc_active_reference= ADC_REFERENCE_UNKNOWN;	//Reference the ADC has settled on.
+uint8_t adc_reference_changed= 0;				//Set by 'adc_select' when the reference changes.
+volatile uint8_t adc_mux_owner= ADC_MUX_OWNER_ADC;	//Peripheral using the input multiplexer.
+uint8_t adc_mux_enabled= 0;						//ADC enable bit saved while another peripheral owns the multiplexer.
+
+//Calibration.
+adc_calibration_container adc_calibration= {ADC_BANDGAP_NOMINAL, 0, ADC_GAIN_UNITY, ADC_TEMPERATURE_RAW_25, ADC_TEMPERATURE_SLOPE};
+uint16_t adc_vcc= 0;							//Last measured VCC in mV. 0 if not measured yet.
+
+//Scanner.
+uint8_t adc_scan_channels[ADC_SCAN_MAX_CHANNELS];	//Channel list.
+uint8_t adc_scan_count= 0;							//Number of entries in the channel list.
+volatile uint16_t adc_scan_table[2][ADC_SCAN_MAX_CHANNELS];	//Double buffered sample table.
+volatile uint8_t adc_scan_front= 0;					//Table holding the latest complete pass. The ISR fills the other one.
+volatile uint8_t adc_scan_index= 0;					//Entry being converted.
+volatile uint8_t adc_scan_passes= 0;				//Completed passes.
+uint8_t adc_scan_oversample_bits= 0;				//Extra bits per entry (4^n conversions per entry).
+volatile uint32_t adc_scan_sum= 0;
+volatile uint16_t adc_scan_samples= 0;
+volatile uint8_t adc_scan_discard= 0;				//Conversions to discard after a reference or mux change.
+
+//Schedule. Every entry is converted once every 'divisor' passes.
+uint16_t adc_scan_divisor[ADC_SCAN_MAX_CHANNELS];
+uint16_t adc_scan_countdown[ADC_SCAN_MAX_CHANNELS];	//Passes until the entry is due.
+volatile uint8_t adc_scan_due= 0;					//Entries converted in the current pass (bit per entry).
+uint8_t adc_scan_trigger= ADC_TRIGGER_FREE_RUNNING;	//Pass trigger. Free running passes start back to back.
+volatile uint16_t adc_scan_overruns= 0;				//Paced passes that didn't finish before the next trigger.
+volatile uint8_t adc_scan_pass_start= 0;			//Set until the first conversion of a paced pass completes.
+
+//Thresholds of the scanner entries.
+uint16_t adc_threshold_low[ADC_SCAN_MAX_CHANNELS];
+uint16_t adc_threshold_high[ADC_SCAN_MAX_CHANNELS];
+uint16_t adc_threshold_hysteresis[ADC_SCAN_MAX_CHANNELS];
+volatile uint8_t adc_threshold_state[ADC_SCAN_MAX_CHANNELS];
+uint8_t adc_threshold_mask= 0;						//Entries with thresholds (bit per entry).
+volatile uint8_t adc_threshold_events= 0;			//Entries whose state changed (bit per entry).
+void (*adc_threshold_callback)(uint8_t index, uint8_t state)= 0;	//Called from the ISR on a state change.
+
+//Oversampled single reads.
+volatile uint32_t adc_oversample_sum= 0;
+volatile uint16_t adc_oversample_remaining= 0;
+volatile uint8_t adc_oversample_sleep= 0;
+
+//Continuous acquisition. Lock free: the ISR only writes the head, readers only write the tail.
+volatile uint8_t adc_stream_buffer[ADC_STREAM_BUFFER_SIZE];
+volatile uint8_t adc_stream_head= 0;
+volatile uint8_t adc_stream_tail= 0;
+volatile uint16_t adc_stream_overruns= 0;
+uint8_t adc_stream_resolution= ADC_RESOLUTION_10_BIT;
+uint8_t adc_stream_trigger= ADC_TRIGGER_FREE_RUNNING;
+
+//Timer prescalers (CS bits 1- 5) for the timer triggers.
+static const uint16_t adc_timer_prescalers[]= {1, 8, 64, 256, 1024};
+
+/*
+Run Timer 0 (compare A) or Timer 1 (compare B) in CTC mode at 'rate' (Hz) to trigger conversions. The smallest prescaler that fits is used.
+Claims the timer through the timer resource manager.
+Returns the actual rate in Hz (0 if the rate can't be reached or another driver holds the timer).
+*/
+static uint32_t adc_timer_start(uint8_t trigger, uint32_t rate){
+	uint32_t top= 0;
+	uint8_t clock_select= 0;
+	
+	if(rate== 0){
+		return 0;
+	}
+	//Find the smallest prescaler that fits the timer (8 bit Timer 0, 16 bit Timer 1).
+	for(clock_select= 0; clock_select< 5; clock_select++){
+		top= F_CPU/ ((uint32_t)adc_timer_prescalers[clock_select]* rate);
+		if(top> 0 && top- 1<= ((trigger== ADC_TRIGGER_TIMER0_COMPARE_A)? 0xFFUL: 0xFFFFUL)){
+			break;
+		}
+	}
+	if(clock_select>= 5 || top== 0){
+		return 0;
+	}
+	rate= F_CPU/ ((uint32_t)adc_timer_prescalers[clock_select]* top);	//Actual rate.
+	top--;
+	
+	if(trigger== ADC_TRIGGER_TIMER0_COMPARE_A){
+		if(timer_resource_claim(TIMER_RESOURCE_TIMER_0, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A, TIMER_OWNER_ADC, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){
+			return 0;
+		}
+	}else if(timer_resource_claim(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A | TIMER_RESOURCE_COMPARE_B, TIMER_OWNER_ADC, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){
+		return 0;
+	}
+	
+	if(trigger== ADC_TRIGGER_TIMER0_COMPARE_A){
+		TCCR0B= 0;
+		TCCR0A= (1<< WGM01);	//CTC, TOP= OCR0A.
+		TIMSK0= 0;
+		TCNT0= 0;
+		OCR0A= top;
+		TIFR0= (1<< OCF0A);
+		TCCR0B= clock_select+ 1;
+	}else{
+		TCCR1B= 0;
+		TCCR1A= 0;				//CTC, TOP= OCR1A.
+		TIMSK1= 0;
+		TCNT1= 0;
+		OCR1A= top;
+		OCR1B= top;				//Compare B matches once per period.
+		TIFR1= (1<< OCF1B);
+		TCCR1B= (1<< WGM12) | (clock_select+ 1);
+	}
+	return rate;
+}
+
+/*
+Stop the timer of a timer trigger and release it. Nothing is done for 'ADC_TRIGGER_FREE_RUNNING'.
+*/
+static void adc_timer_stop(uint8_t trigger){
+	if(trigger== ADC_TRIGGER_TIMER0_COMPARE_A){
+		TCCR0B= 0;
+		timer_resource_release(TIMER_RESOURCE_TIMER_0, TIMER_OWNER_ADC);
+	}else if(trigger== ADC_TRIGGER_TIMER1_COMPARE_B){
+		TCCR1B= 0;
+		timer_resource_release(TIMER_RESOURCE_TIMER_1, TIMER_OWNER_ADC);
+	}
+}
+
+/*
+Clear the compare flag of a timer trigger. The trigger is the rising edge of the flag, so it has to be cleared for the next one.
+*/
+static inline void adc_trigger_clear(uint8_t trigger){
+	if(trigger== ADC_TRIGGER_TIMER0_COMPARE_A){
+		TIFR0= (1<< OCF0A);
+	}else if(trigger== ADC_TRIGGER_TIMER1_COMPARE_B){
+		TIFR1= (1<< OCF1B);
+	}
+}
+
+/*
+Push a sample into the ring buffer. Counts an overrun instead if the buffer is full.
+*/
+static inline void adc_stream_push(void){
+	uint8_t head= adc_stream_head;
+	uint8_t size= (adc_stream_resolution== ADC_RESOLUTION_8_BIT)? 1: 2;
+	
+	if(((adc_stream_tail- head- 1) & ADC_STREAM_BUFFER_MASK)< size){
+		adc_stream_overruns++;	//The result registers are simply overwritten by the next conversion.
+		return;
+	}
+	
+	if(size== 2){
+		adc_stream_buffer[head]= ADCL;	//Read low byte first.
+		head= (head+ 1) & ADC_STREAM_BUFFER_MASK;
+	}
+	adc_stream_buffer[head]= ADCH;
+	adc_stream_head= (head+ 1) & ADC_STREAM_BUFFER_MASK;
+}
+
+/*
+Select a channel. The channel can carry reference bits (ADC_AREF_AVCC, ADC_AREF_INTERNAL_BANDGAP), else the reference passed to 'adc_set' is used.
+Returns the number of conversions to discard: 'ADC_REFERENCE_SETTLE_CONVERSIONS' if the reference changed,
+1 if the temperature sensor or the bandgap was just selected, else 0.
+*/
+static inline uint8_t adc_select(uint8_t channel, uint8_t left_adjust){
+	uint8_t reference= channel & ADC_AREF_BITS;
+	uint8_t mux= channel & ADC_MUX_BITS;
+	uint8_t discard= 0;
+	
+	if(reference== 0){
+		reference= adc_reference;
+	}
+	if(reference!= adc_active_reference){
+		adc_active_reference= reference;
+		adc_reference_changed= 1;
+		discard= ADC_REFERENCE_SETTLE_CONVERSIONS;
+	}else if(mux>= ADC_CHANNEL_TEMPERATURE_SENSOR && (ADMUX & ADC_MUX_BITS)!= mux){
+		discard= 1;		//Internal sources need time after being selected.
+	}
+	ADMUX= reference | left_adjust | mux;
+	return discard;
+}
+
+/*
+Select a channel and run the discard conversions in the foreground. Waits 'ADC_REFERENCE_SETTLE_DELAY' if the reference changed.
+Right adjusted (10 bit) selections restore the prescaler passed to 'adc_set' if the 8 bit profile left the fast one behind.
+Nothing else is done if the channel and the reference are unchanged.
+*/
+static void adc_select_and_settle(uint8_t channel, uint8_t left_adjust){
+	uint8_t discard= 0;
+	
+	if(!left_adjust && (ADCSRA & ADC_PRESCALER_BITS)!= adc_prescaler){
+		ADCSRA= (ADCSRA & ~(ADC_PRESCALER_BITS | ADC_INTERRUPT_FLAG)) | adc_prescaler;	//Writing a 0 to the flag leaves it alone.
+	}
+	adc_disable_digital_buffer(channel & ADC_MUX_BITS);
+	adc_reference_changed= 0;
+	discard= adc_select(channel, left_adjust);
+	if(adc_reference_changed){
+		_delay_us(ADC_REFERENCE_SETTLE_DELAY);	//AREF capacitor.
+	}
+	while(discard--){
+		ADCSRA|= ADC_SINGLE_CONVERSION_PENDING;
+		while(ADCSRA & ADC_SINGLE_CONVERSION_PENDING);
+	}
+}
+
+/*
+Evaluate the thresholds of a scanner entry. Called from the ISR with every stored sample.
+A state is left only after the sample moves back past the threshold by the hysteresis.
+*/
+static inline void adc_threshold_check(uint8_t index, uint16_t value){
+	uint8_t state= adc_threshold_state[index];
+	uint8_t new_state= ADC_THRESHOLD_INSIDE;
+	
+	if(value> adc_threshold_high[index]){
+		new_state= ADC_THRESHOLD_ABOVE;
+	}else if(value< adc_threshold_low[index]){
+		new_state= ADC_THRESHOLD_BELOW;
+	}else if(state== ADC_THRESHOLD_ABOVE && adc_threshold_high[index]- value< adc_threshold_hysteresis[index]){	//Inside the window here, so the differences can't wrap.
+		new_state= ADC_THRESHOLD_ABOVE;
+	}else if(state== ADC_THRESHOLD_BELOW && value- adc_threshold_low[index]< adc_threshold_hysteresis[index]){
+		new_state= ADC_THRESHOLD_BELOW;
+	}
+	
+	if(new_state!= state){
+		adc_threshold_state[index]= new_state;
+		adc_threshold_events|= (1<< index);
+		if(adc_threshold_callback){
+			adc_threshold_callback(index, new_state);
+		}
+	}
+}
+
+/*
+Count down every entry of the schedule. Returns the entries due in the next pass (bit per entry).
+*/
+static inline uint8_t adc_scan_next_pass(void){
+	uint8_t due= 0;
+	
+	for(uint8_t i= 0; i< adc_scan_count; i++){
+		if(--adc_scan_countdown[i]== 0){
+			adc_scan_countdown[i]= adc_scan_divisor[i];
+			due|= (1<< i);
+		}
+	}
+	return due;
+}
+
+/*
+Return the first entry from 'index' on that is due in the current pass. Returns 'adc_scan_count' at the end of the pass.
+*/
+static inline uint8_t adc_scan_next_entry(uint8_t index){
+	while(index< adc_scan_count && !(adc_scan_due & (1<< index))){
+		index++;
+	}
+	return index;
+}
+
+/*
+Scanner part of the conversion complete interrupt.
+Accumulates 4^n conversions per entry when oversampling, then stores the result and moves to the next entry.
+*/
+static inline void adc_scan_isr(uint16_t value){
+	uint8_t index= adc_scan_index;
+	
+	if(adc_scan_pass_start){	//First conversion of a paced pass. Clear its trigger so a trigger seen at the end of the pass is a new one.
+		adc_scan_pass_start= 0;
+		adc_trigger_clear(adc_scan_trigger);
+	}
+	if(adc_scan_discard){	//Settling after a reference or mux change.
+		adc_scan_discard--;
+		ADCSRA|= ADC_START_CONVERSION;
+		return;
+	}
+	
+	if(adc_scan_oversample_bits){
+		adc_scan_sum+= value;
+		if(++adc_scan_samples< (1U<< (adc_scan_oversample_bits<< 1))){
+			ADCSRA|= ADC_START_CONVERSION;	//Same channel again.
+			return;
+		}
+		value= adc_scan_sum>> adc_scan_oversample_bits;	//Decimate.
+		adc_scan_sum= 0;
+		adc_scan_samples= 0;
+	}
+	
+	adc_scan_table[adc_scan_front^ 1][index]= value;
+	if(adc_threshold_mask & (1<< index)){
+		adc_threshold_check(index, value);
+	}
+	
+	index= adc_scan_next_entry(index+ 1);
+	if(index>= adc_scan_count){	//Pass complete. Publish the table.
+		for(uint8_t i= 0; i< adc_scan_count; i++){
+			if(!(adc_scan_due & (1<< i))){
+				adc_scan_table[adc_scan_front^ 1][i]= adc_scan_table[adc_scan_front][i];	//Not due. Carry the last sample over.
+			}
+		}
+		adc_scan_front^= 1;
+		adc_scan_passes++;
+		adc_scan_due= adc_scan_next_pass();
+		index= adc_scan_next_entry(0);
+		
+		if(adc_scan_trigger!= ADC_TRIGGER_FREE_RUNNING){	//Paced. The next pass starts on the next trigger.
+			if(adc_scan_trigger== ADC_TRIGGER_TIMER0_COMPARE_A? (TIFR0 & (1<< OCF0A)): (TIFR1 & (1<< OCF1B))){
+				adc_scan_overruns++;	//The trigger of the next pass was missed.
+			}
+			adc_trigger_clear(adc_scan_trigger);
+			adc_scan_pass_start= 1;
+			adc_scan_index= index;
+			adc_scan_discard= adc_select(adc_scan_channels[index], 0);
+			return;
+		}
+	}
+	adc_scan_index= index;
+	
+	adc_scan_discard= adc_select(adc_scan_channels[index], 0);	//Single entry lists and same reference entries discard nothing.
+	ADCSRA|= ADC_START_CONVERSION;	//Start the next conversion.
+}
+
+/*
+Conversion complete interrupt. Dispatches to the active mode.
+*/
+ISR(ADC_vect){
+	uint16_t value= 0;
+	
+	if(adc_mode== ADC_MODE_STREAM){
+		adc_stream_push();
+		adc_trigger_clear(adc_stream_trigger);
+		return;
+	}
+	
+	value= ADCL;	//Read low byte first.
+	value|= (ADCH<< 8);
+	
+	if(adc_mode== ADC_MODE_SCAN){
+		adc_scan_isr(value);
+	}else if(adc_mode== ADC_MODE_OVERSAMPLE){
+		adc_oversample_sum+= value;
+		if(--adc_oversample_remaining && !adc_oversample_sleep){
+			ADCSRA|= ADC_START_CONVERSION;	//In sleep mode the next conversion starts when the CPU goes back to sleep.
+		}
+	}
+}
+
 /*
 Set up the ADC peripheral.
+While another peripheral owns the multiplexer, the settings are kept and the ADC is enabled when the multiplexer is released.
 */
 void adc_set(uint8_t reference_voltage, uint8_t interrupt_enable, uint8_t prescaler){
-	ADMUX|= reference_voltage;
-	ADCSRA|= ((1<< ADEN) | interrupt_enable | prescaler); //Enable the ADC and set pre-scaler.
+	adc_prescaler= prescaler;
+	adc_reference= reference_voltage;
+	adc_active_reference= ADC_REFERENCE_UNKNOWN;	//The next selection settles the reference.
+	if(adc_mux_owner!= ADC_MUX_OWNER_ADC){	//ADEN would switch the comparator back to AIN1.
+		adc_mux_enabled= (1<< ADEN);
+		ADCSRA= (ADCSRA & ~(ADC_PRESCALER_BITS | ADC_INTERRUPT_ENABLE | ADC_INTERRUPT_FLAG)) | interrupt_enable | prescaler;
+		return;
+	}
+	ADMUX= (ADMUX & ~ADC_AREF_BITS) | reference_voltage;
+	ADCSRA= (ADCSRA & ~(ADC_PRESCALER_BITS | ADC_INTERRUPT_ENABLE | ADC_INTERRUPT_FLAG)) | (1<< ADEN) | interrupt_enable | prescaler; //Enable the ADC and set pre-scaler.
 }
 
 /*
 Return a 10 bit ADC reading in single conversion mode.
+The channel can carry reference bits (e.g. 'ADC_CHANNEL_BANDGAP | ADC_AREF_AVCC'). Settling conversions are run only if the reference or the internal source changes.
+Returns 0 if the scanner, continuous acquisition or an oversampled read is running.
 */
 uint16_t adc_read(uint8_t channel){
+	if(adc_mode!= ADC_MODE_SINGLE || adc_mux_owner!= ADC_MUX_OWNER_ADC){
+		return 0;
+	}
 	//Single conversion mode.
-	adc_disable_digital_buffer(channel);
-	ADMUX&= ADC_CHANNEL_DESELECT; //Clear previously set channels.
-	ADMUX|= channel; //Set the channel.
+	adc_select_and_settle(channel, 0);	//Right adjusted result.
 	ADCSRA|= ADC_SINGLE_CONVERSION_PENDING; //Start single conversion.
 	while(ADCSRA & ADC_SINGLE_CONVERSION_PENDING); //Wait for conversion to complete (for bit to become 0).
 	
@@ -31,6 +384,37 @@ uint16_t adc_read(uint8_t channel){
 	return value;
 }
 
+/*
+Return an 8 bit ADC reading in single conversion mode.
+The result is left adjusted so only ADCH is read. Use 'adc_set_resolution(ADC_RESOLUTION_8_BIT)' for the fast prescaler profile.
+Returns 0 if the scanner, continuous acquisition or an oversampled read is running.
+*/
+uint8_t adc_read_8bit(uint8_t channel){
+	if(adc_mode!= ADC_MODE_SINGLE || adc_mux_owner!= ADC_MUX_OWNER_ADC){
+		return 0;
+	}
+	adc_select_and_settle(channel, ADC_LEFT_ADJUST);
+	ADCSRA|= ADC_SINGLE_CONVERSION_PENDING;
+	while(ADCSRA & ADC_SINGLE_CONVERSION_PENDING);
+	return ADCH;
+}
+
+/*
+Select the prescaler profile.
+'ADC_RESOLUTION_8_BIT' switches to 'ADC_PRESCALER_FAST_8_BIT' and left adjusted results.
+'ADC_RESOLUTION_10_BIT' restores the prescaler passed to 'adc_set' and right adjusted results.
+The 10 bit reads ('adc_read', 'adc_read_oversampled', the scanner) restore the prescaler themselves, so they stay within spec after 8 bit use.
+*/
+void adc_set_resolution(uint8_t resolution){
+	if(resolution== ADC_RESOLUTION_8_BIT){
+		ADMUX|= ADC_LEFT_ADJUST;
+		ADCSRA= (ADCSRA & ~(ADC_PRESCALER_BITS | ADC_INTERRUPT_FLAG)) | ADC_PRESCALER_FAST_8_BIT;	//Writing a 0 to the flag leaves it alone.
+	}else{
+		ADMUX&= ~ADC_LEFT_ADJUST;
+		ADCSRA= (ADCSRA & ~(ADC_PRESCALER_BITS | ADC_INTERRUPT_FLAG)) | adc_prescaler;
+	}
+}
+
 /*
 Disable the digital input buffer of a channel for power saving (not required).
 */
@@ -38,12 +422,632 @@ void adc_disable_digital_buffer(uint8_t channel){
 	DIDR0&= ~channel;
 }
 
+/*
+Return the temperature from the internal temperature sensor (in Celcius).
+Wrapper of 'adc_read_temperature'.
+*/
 uint16_t adc_read_temperature_sensor(){
-	uint16_t raw_value= 0;
+	if(!(ADCSRA & (1<< ADEN))){
+		adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
+	}
+	return (uint16_t)(adc_read_temperature()/ 100);
+}
+
+/*
+Average 'ADC_CALIBRATION_SAMPLES' conversions of a channel against a given reference.
+*/
+static uint16_t adc_read_reference(uint8_t channel, uint8_t reference){
+	uint16_t sum= 0;
+	
+	for(uint8_t i= 0; i< ADC_CALIBRATION_SAMPLES; i++){
+		sum+= adc_read(channel | reference);	//Settles only on the first read.
+	}
+	return (sum+ (ADC_CALIBRATION_SAMPLES>> 1))/ ADC_CALIBRATION_SAMPLES;
+}
+
+/*
+Return the calibrated temperature from the internal temperature sensor in hundredths of a degree Celsius.
+Uses the internal bandgap reference. The ADC must be set up with 'adc_set' and must not be scanning or streaming.
+Accuracy is about +/-10C uncalibrated and +/-2C after 'adc_calibrate_temperature'.
+*/
+int16_t adc_read_temperature(void){
+	int32_t difference= (int32_t)adc_read_reference(ADC_CHANNEL_TEMPERATURE_SENSOR, ADC_AREF_INTERNAL_BANDGAP)- adc_calibration.temperature_raw;
+	
+	return 2500+ ((difference* adc_calibration.temperature_slope+ 128)>> 8);
+}
+
+/*
+Measure VCC against the internal bandgap (AVCC reference, bandgap channel). Returns mV and updates 'adc_vcc'.
+The ADC must be set up with 'adc_set' and must not be scanning or streaming.
+*/
+uint16_t adc_read_vcc(void){
+	uint16_t raw= adc_read_reference(ADC_CHANNEL_BANDGAP, ADC_AREF_AVCC);
+	
+	if(raw== 0){
+		return 0;
+	}
+	adc_vcc= ((uint32_t)adc_calibration.bandgap* 1024+ (raw>> 1))/ raw;
+	return adc_vcc;
+}
+
+/*
+Apply the offset and gain correction to a raw 10 bit reading. The result is clamped to 0- 1023.
+*/
+uint16_t adc_calibration_apply(uint16_t raw){
+	int32_t value= (((int32_t)raw- adc_calibration.offset)* adc_calibration.gain+ (ADC_GAIN_UNITY>> 1))>> 14;
+	
+	if(value< 0){
+		return 0;
+	}
+	if(value> 1023){
+		return 1023;
+	}
+	return value;
+}
+
+/*
+Return a calibrated reading of a channel in mV (AVCC reference).
+Uses the last measured VCC ('adc_read_vcc' is called once if VCC hasn't been measured). Call 'adc_read_vcc' again if the supply changes.
+*/
+uint16_t adc_read_millivolts(uint8_t channel){
+	uint16_t raw= 0;
+	
+	if(adc_vcc== 0){
+		adc_read_vcc();
+	}
+	raw= adc_calibration_apply(adc_read_reference(channel, ADC_AREF_AVCC));
+	return ((uint32_t)raw* adc_vcc+ 512)>> 10;
+}
+
+/*
+CRC8 of the calibration data. Used to validate the EEPROM copy.
+*/
+static uint8_t adc_calibration_crc(uint8_t *data){
+	uint8_t crc= 0;
+	for(uint8_t i= 0; i< ADC_CALIBRATION_DATA_SIZE; i++){
+		crc= _crc8_ccitt_update(crc, data[i]);
+	}
+	return crc;
+}
+
+/*
+Load the calibration data from the EEPROM.
+Returns 'ADC_ERROR' and restores the defaults if the EEPROM is empty or corrupt.
+*/
+uint8_t adc_calibration_load(void){
+	uint8_t *data= (uint8_t *)&adc_calibration;
+	
+	eeprom_read_block(data, (const void *)ADC_CALIBRATION_EEPROM_ADDRESS, ADC_CALIBRATION_DATA_SIZE);
+	if(adc_calibration.bandgap== 0x0000 || adc_calibration.bandgap== 0xFFFF ||
+		eeprom_read_byte((const uint8_t *)(ADC_CALIBRATION_EEPROM_ADDRESS+ ADC_CALIBRATION_DATA_SIZE))!= adc_calibration_crc(data)){
+		adc_calibration_reset();
+		return ADC_ERROR;
+	}
+	adc_vcc= 0;
+	return ADC_OK;
+}
+
+/*
+Store the calibration data in the EEPROM. Only changed bytes are written.
+*/
+void adc_calibration_save(void){
+	uint8_t *data= (uint8_t *)&adc_calibration;
 	
-	adc_set(ADC_AREF_INTERNAL_BANDGAP, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
-	raw_value= adc_read(ADC_CHANNEL_TEMPERATURE_SENSOR);
+	eeprom_update_block(data, (void *)ADC_CALIBRATION_EEPROM_ADDRESS, ADC_CALIBRATION_DATA_SIZE);
+	eeprom_update_byte((uint8_t *)(ADC_CALIBRATION_EEPROM_ADDRESS+ ADC_CALIBRATION_DATA_SIZE), adc_calibration_crc(data));
+}
+
+/*
+Restore the default (uncalibrated) calibration data. The EEPROM is not changed.
+*/
+void adc_calibration_reset(void){
+	adc_calibration.bandgap= ADC_BANDGAP_NOMINAL;
+	adc_calibration.offset= 0;
+	adc_calibration.gain= ADC_GAIN_UNITY;
+	adc_calibration.temperature_raw= ADC_TEMPERATURE_RAW_25;
+	adc_calibration.temperature_slope= ADC_TEMPERATURE_SLOPE;
+	adc_vcc= 0;
+}
+
+/*
+Calibrate the bandgap voltage against an externally measured VCC (mV).
+*/
+void adc_calibrate_bandgap(uint16_t vcc){
+	uint16_t raw= adc_read_reference(ADC_CHANNEL_BANDGAP, ADC_AREF_AVCC);
 	
-	return ((uint16_t)((raw_value- 242)* (85- (-45))/ (380- 242)+ (-45)))- 35;
+	adc_calibration.bandgap= ((uint32_t)vcc* raw+ 512)>> 10;
+	adc_vcc= vcc;
 }
 
+/*
+Calibrate the offset and gain from two raw readings and the readings they should have given (in LSB).
+Returns 'ADC_ERROR' if the points are invalid.
+*/
+uint8_t adc_calibrate_gain(uint16_t raw_low, uint16_t expected_low, uint16_t raw_high, uint16_t expected_high){
+	uint32_t gain= 0;
+	
+	if(raw_high<= raw_low || expected_high<= expected_low){
+		return ADC_ERROR;
+	}
+	gain= (((uint32_t)(expected_high- expected_low)<< 14)+ ((raw_high- raw_low)>> 1))/ (raw_high- raw_low);
+	if(gain> 0xFFFF){
+		return ADC_ERROR;
+	}
+	adc_calibration.gain= gain;
+	adc_calibration.offset= (int32_t)raw_low- (int32_t)((((uint32_t)expected_low<< 14)+ (gain>> 1))/ gain);
+	return ADC_OK;
+}
+
+/*
+Calibrate the temperature sensor at a known temperature (hundredths of a degree Celsius). Single point offset calibration.
+*/
+void adc_calibrate_temperature(int16_t temperature){
+	uint16_t raw= adc_read_reference(ADC_CHANNEL_TEMPERATURE_SENSOR, ADC_AREF_INTERNAL_BANDGAP);
+	
+	adc_calibration.temperature_raw= raw- (((int32_t)(temperature- 2500)<< 8)/ adc_calibration.temperature_slope);
+}
+
+/*
+Set the channel list of the scanner (up to 'ADC_SCAN_MAX_CHANNELS' entries).
+A channel can be listed more than once to sample it more often.
+*/
+uint8_t adc_scan_set(const uint8_t channels[], uint8_t count){
+	if(count== 0 || count> ADC_SCAN_MAX_CHANNELS){
+		return ADC_ERROR;
+	}
+	
+	adc_scan_stop();
+	for(uint8_t i= 0; i< count; i++){
+		adc_scan_channels[i]= channels[i] & (ADC_MUX_BITS | ADC_AREF_BITS);
+		adc_disable_digital_buffer(channels[i] & ADC_MUX_BITS);
+		adc_scan_table[0][i]= 0;
+		adc_scan_table[1][i]= 0;
+		adc_scan_divisor[i]= 1;		//Every pass.
+	}
+	adc_scan_count= count;
+	return ADC_OK;
+}
+
+/*
+Start scanning the channel list in the background. The ADC must be set up with 'adc_set'.
+Each conversion complete interrupt stores the result, selects the next channel and starts the next conversion.
+Passes run back to back. Use 'adc_schedule_start' to pace them with a timer.
+*/
+void adc_scan_start(void){
+	adc_schedule_start(ADC_TRIGGER_FREE_RUNNING, 0);
+}
+
+/*
+Stop scanning. A conversion in progress completes without being stored.
+The pass timer is stopped and released.
+*/
+void adc_scan_stop(void){
+	if(adc_mode!= ADC_MODE_SCAN){
+		return;
+	}
+	ADCSRA&= ~(ADC_INTERRUPT_ENABLE | ADC_AUTO_TRIGGER_ENABLE);
+	adc_mode= ADC_MODE_SINGLE;
+	adc_timer_stop(adc_scan_trigger);
+	while(ADCSRA & ADC_SINGLE_CONVERSION_PENDING);	//Let the last conversion finish before the ADC is used again.
+}
+
+/*
+Return the latest sample of a channel list entry from the last complete pass. Returns 0 for entries outside the channel list.
+*/
+uint16_t adc_scan_read(uint8_t index){
+	uint16_t temp;
+	if(index>= adc_scan_count){
+		return 0;
+	}
+	cli();		//Prevent the table from being swapped during the read.
+	temp= adc_scan_table[adc_scan_front][index];
+	sei();
+	return temp;
+}
+
+/*
+Copy the latest complete pass of the channel list. All values come from the same pass.
+Requires an array of size 'ADC_SCAN_MAX_CHANNELS' (or the number of entries in the channel list).
+*/
+void adc_scan_read_all(uint16_t values[]){
+	cli();
+	for(uint8_t i= 0; i< adc_scan_count; i++){
+		values[i]= adc_scan_table[adc_scan_front][i];
+	}
+	sei();
+}
+
+/*
+Return the number of completed passes. Wraps around. Compare with a previous value to detect new data.
+*/
+uint8_t adc_scan_get_pass_count(void){
+	return adc_scan_passes;
+}
+
+/*
+Start continuous acquisition of a channel into the ring buffer. The ADC must be set up with 'adc_set'.
+Free running: the rate is set by the ADC prescaler (F_CPU/ prescaler/ 13). 'sample_rate' is ignored.
+Timer 0 compare A/ Timer 1 compare B: the timer runs in CTC mode at 'sample_rate' (Hz). The smallest prescaler that fits is used.
+8 bit resolution switches to the fast prescaler profile, left adjusts the result and stores only ADCH, halving the buffer usage.
+Returns the actual sample rate in Hz (0 if the rate can't be reached).
+*/
+uint32_t adc_stream_start(uint8_t channel, uint8_t trigger, uint32_t sample_rate, uint8_t resolution){
+	if(adc_mux_owner!= ADC_MUX_OWNER_ADC){
+		return 0;
+	}
+	adc_scan_stop();
+	adc_stream_stop();
+	
+	adc_stream_head= 0;
+	adc_stream_tail= 0;
+	adc_stream_overruns= 0;
+	adc_stream_resolution= resolution;
+	adc_stream_trigger= trigger;
+	
+	if(trigger!= ADC_TRIGGER_FREE_RUNNING){
+		sample_rate= adc_timer_start(trigger, sample_rate);
+		if(sample_rate== 0){
+			return 0;
+		}
+	}else{
+		sample_rate= 0;	//Set by the ADC prescaler.
+	}
+	
+	adc_select_and_settle(channel, 0);
+	adc_set_resolution(resolution);
+	ADCSRB= (ADCSRB & ~ADC_TRIGGER_SOURCE_BITS) | trigger;
+	adc_mode= ADC_MODE_STREAM;
+	ADCSRA|= ADC_INTERRUPT_FLAG;
+	adc_trigger_clear(trigger);		//The timer has been running while the reference settled. Wait for the next edge.
+	ADCSRA|= (ADC_INTERRUPT_ENABLE | ADC_AUTO_TRIGGER_ENABLE);
+	sei();
+	if(trigger== ADC_TRIGGER_FREE_RUNNING){
+		ADCSRA|= ADC_START_CONVERSION;	//The first conversion has to be started manually.
+	}
+	return sample_rate;
+}
+
+/*
+Stop continuous acquisition. Samples already in the ring buffer can still be read.
+The trigger timer is stopped and released.
+*/
+void adc_stream_stop(void){
+	if(adc_mode!= ADC_MODE_STREAM){
+		return;
+	}
+	ADCSRA&= ~(ADC_INTERRUPT_ENABLE | ADC_AUTO_TRIGGER_ENABLE);
+	adc_mode= ADC_MODE_SINGLE;
+	adc_timer_stop(adc_stream_trigger);
+	while(ADCSRA & ADC_SINGLE_CONVERSION_PENDING);
+	adc_set_resolution(ADC_RESOLUTION_10_BIT);	//Back to right adjusted results and the 10 bit prescaler.
+}
+
+/*
+Return the number of samples in the ring buffer.
+*/
+uint8_t adc_stream_available(void){
+	uint8_t bytes= (adc_stream_head- adc_stream_tail) & ADC_STREAM_BUFFER_MASK;
+	return (adc_stream_resolution== ADC_RESOLUTION_8_BIT)? bytes: (bytes>> 1);
+}
+
+/*
+Pop the oldest sample from the ring buffer. 8 bit samples are returned in the low byte.
+Returns 'ADC_ERROR' if the buffer is empty.
+*/
+uint8_t adc_stream_read(uint16_t *sample){
+	uint8_t tail= adc_stream_tail;
+	
+	if(adc_stream_available()== 0){
+		return ADC_ERROR;
+	}
+	
+	if(adc_stream_resolution== ADC_RESOLUTION_8_BIT){
+		*sample= adc_stream_buffer[tail];
+	}else{
+		*sample= adc_stream_buffer[tail] | (adc_stream_buffer[(tail+ 1) & ADC_STREAM_BUFFER_MASK]<< 8);
+		tail++;
+	}
+	adc_stream_tail= (tail+ 1) & ADC_STREAM_BUFFER_MASK;	//Single byte write. Safe against the ISR.
+	return ADC_OK;
+}
+
+/*
+Return the number of samples dropped because the ring buffer was full.
+*/
+uint16_t adc_stream_get_overruns(void){
+	uint16_t temp;
+	cli();
+	temp= adc_stream_overruns;
+	sei();
+	return temp;
+}
+
+/*
+Set the number of extra bits (0- 'ADC_OVERSAMPLE_MAX_BITS') the scanner adds to every entry.
+Each entry is converted 4^n times, summed and shifted right by n. Results are 10+ n bits wide.
+Takes effect on the next 'adc_scan_start'.
+*/
+void adc_scan_set_oversampling(uint8_t extra_bits){
+	if(extra_bits> ADC_OVERSAMPLE_MAX_BITS){
+		extra_bits= ADC_OVERSAMPLE_MAX_BITS;
+	}
+	adc_scan_stop();
+	adc_scan_oversample_bits= extra_bits;
+}
+
+/*
+Returns 1 if a driver holds a timer that ADC noise reduction sleep would stop (Timer 0, Timer 1 or the synchronous Timer 2).
+*/
+static uint8_t adc_timers_running(void){
+	if(timer_resource_get_owner(TIMER_RESOURCE_TIMER_0, TIMER_RESOURCE_BASE)!= TIMER_OWNER_NONE || 
+	timer_resource_get_owner(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE)!= TIMER_OWNER_NONE){
+		return 1;
+	}
+	return (timer_resource_get_owner(TIMER_RESOURCE_TIMER_2, TIMER_RESOURCE_BASE)!= TIMER_OWNER_NONE && !(ASSR & (1<< AS2)));
+}
+
+/*
+Return a 10+ n bit reading of a channel by oversampling and decimation (4^n conversions, summed and shifted right by n).
+Extra resolution needs at least 1 LSB of noise on the signal.
+If 'noise_reduction' is set, the CPU sleeps in ADC noise reduction mode during every conversion.
+The sleep mode halts clk_I/O: Timer 0, Timer 1, the synchronous Timer 2, the USART and SPI stop for every conversion and can't wake the CPU.
+So noise reduction is skipped (the conversions run awake) while a driver holds one of those timers, e.g. after 'timer_set_millis'.
+Data arriving on the USART while sleeping is lost. Pin change, external and TWI address match interrupts can still wake the CPU early.
+Conversions are driven by the conversion complete interrupt. Returns 0 if the scanner or continuous acquisition is running.
+*/
+uint16_t adc_read_oversampled(uint8_t channel, uint8_t extra_bits, uint8_t noise_reduction){
+	uint8_t interrupt_enable= ADCSRA & ADC_INTERRUPT_ENABLE;	//Set by 'adc_set'. Restored at the end.
+	
+	if(adc_mode!= ADC_MODE_SINGLE || adc_mux_owner!= ADC_MUX_OWNER_ADC){
+		return 0;
+	}
+	if(extra_bits> ADC_OVERSAMPLE_MAX_BITS){
+		extra_bits= ADC_OVERSAMPLE_MAX_BITS;
+	}
+	
+	if(noise_reduction && adc_timers_running()){
+		noise_reduction= 0;	//The timers would lose time.
+	}
+	
+	adc_select_and_settle(channel, 0);
+	adc_oversample_sum= 0;
+	adc_oversample_remaining= 1U<< (extra_bits<< 1);
+	adc_oversample_sleep= noise_reduction;
+	adc_mode= ADC_MODE_OVERSAMPLE;
+	ADCSRA|= ADC_INTERRUPT_FLAG;
+	ADCSRA|= ADC_INTERRUPT_ENABLE;
+	
+	if(noise_reduction){
+		set_sleep_mode(SLEEP_MODE_ADC);
+		while(1){
+			cli();
+			if(adc_oversample_remaining== 0){
+				break;
+			}
+			if(ADCSRA & ADC_START_CONVERSION){	//Woken early by another interrupt. Let the conversion finish.
+				sei();
+				continue;
+			}
+			sleep_enable();
+			sei();
+			sleep_cpu();	//Entering the mode starts a conversion. The instruction after 'sei' always executes before an interrupt.
+			sleep_disable();
+		}
+		sei();
+	}else{
+		sei();
+		ADCSRA|= ADC_START_CONVERSION;
+		while(1){
+			cli();	//16 bit counter. Read atomically.
+			if(adc_oversample_remaining== 0){
+				break;
+			}
+			sei();
+		}
+		sei();
+	}
+	
+	adc_mode= ADC_MODE_SINGLE;
+	ADCSRA= (ADCSRA & ~ADC_INTERRUPT_ENABLE) | interrupt_enable;
+	return adc_oversample_sum>> extra_bits;
+}
+
+/*
+Set the thresholds of a scanner entry (in the units of the entry, including oversampling).
+The state changes to 'ADC_THRESHOLD_ABOVE' above 'high' and to 'ADC_THRESHOLD_BELOW' below 'low'.
+It goes back to 'ADC_THRESHOLD_INSIDE' only 'hysteresis' inside the window. The state starts as inside.
+*/
+uint8_t adc_threshold_set(uint8_t index, uint16_t low, uint16_t high, uint16_t hysteresis){
+	if(index>= ADC_SCAN_MAX_CHANNELS || low> high){
+		return ADC_ERROR;
+	}
+	
+	cli();
+	adc_threshold_low[index]= low;
+	adc_threshold_high[index]= high;
+	adc_threshold_hysteresis[index]= hysteresis;
+	adc_threshold_state[index]= ADC_THRESHOLD_INSIDE;
+	adc_threshold_events&= ~(1<< index);
+	adc_threshold_mask|= (1<< index);
+	sei();
+	return ADC_OK;
+}
+
+/*
+Remove the thresholds of a scanner entry.
+*/
+void adc_threshold_clear(uint8_t index){
+	if(index>= ADC_SCAN_MAX_CHANNELS){
+		return;
+	}
+	cli();
+	adc_threshold_mask&= ~(1<< index);
+	adc_threshold_events&= ~(1<< index);
+	sei();
+}
+
+/*
+Return the entries whose threshold state changed since the last call (bit per entry) and clear them.
+*/
+uint8_t adc_threshold_get_events(void){
+	uint8_t events;
+	cli();
+	events= adc_threshold_events;
+	adc_threshold_events= 0;
+	sei();
+	return events;
+}
+
+/*
+Return the threshold state of a scanner entry.
+*/
+uint8_t adc_threshold_get_state(uint8_t index){
+	return adc_threshold_state[index];
+}
+
+/*
+Set a function called from the ISR on every threshold state change (0 to remove it). Keep it short.
+*/
+void adc_threshold_set_callback(void (*callback)(uint8_t index, uint8_t state)){
+	cli();
+	adc_threshold_callback= callback;
+	sei();
+}
+
+/*
+Take the input multiplexer for another peripheral (e.g. the analog comparator).
+The ADC must be idle (not scanning or streaming). It is disabled until the multiplexer is released and its reads return 0.
+Returns 'ADC_ERROR' if the ADC is busy or another peripheral owns the multiplexer.
+*/
+uint8_t adc_mux_acquire(uint8_t owner){
+	cli();
+	if(adc_mux_owner== owner){
+		sei();
+		return ADC_OK;
+	}
+	if(adc_mux_owner!= ADC_MUX_OWNER_ADC || adc_mode!= ADC_MODE_SINGLE){
+		sei();
+		return ADC_ERROR;
+	}
+	adc_mux_owner= owner;
+	sei();
+	
+	while(ADCSRA & ADC_SINGLE_CONVERSION_PENDING);
+	adc_mux_enabled= ADCSRA & (1<< ADEN);
+	ADCSRA&= ~((1<< ADEN) | ADC_INTERRUPT_FLAG);
+	return ADC_OK;
+}
+
+/*
+Give the input multiplexer back to the ADC. Restores the ADC enable bit.
+The next conversion selects its channel again (the owner may have changed the multiplexer).
+*/
+void adc_mux_release(uint8_t owner){
+	if(adc_mux_owner!= owner || owner== ADC_MUX_OWNER_ADC){
+		return;
+	}
+	ADCSRA= (ADCSRA & ~ADC_INTERRUPT_FLAG) | adc_mux_enabled;
+	adc_mux_owner= ADC_MUX_OWNER_ADC;
+}
+
+/*
+Return the peripheral that owns the input multiplexer.
+*/
+uint8_t adc_mux_get_owner(void){
+	return adc_mux_owner;
+}
+
+/*
+Set a static schedule: a channel list with a rate divisor per entry (1- 65535). An entry is converted once every 'divisor' passes.
+Entries with the same divisor are staggered over different passes. At least one entry must have a divisor of 1.
+With paced passes ('adc_schedule_start') the sample rate of an entry is the pass rate divided by its divisor.
+*/
+uint8_t adc_schedule_set(const adc_schedule_entry schedule[], uint8_t count){
+	uint8_t every_pass= 0;
+	
+	if(count== 0 || count> ADC_SCAN_MAX_CHANNELS){
+		return ADC_ERROR;
+	}
+	for(uint8_t i= 0; i< count; i++){
+		if(schedule[i].divisor== 0){
+			return ADC_ERROR;
+		}
+		if(schedule[i].divisor== 1){
+			every_pass= 1;
+		}
+	}
+	if(!every_pass){
+		return ADC_ERROR;
+	}
+	
+	adc_scan_stop();
+	for(uint8_t i= 0; i< count; i++){
+		adc_scan_channels[i]= schedule[i].channel & (ADC_MUX_BITS | ADC_AREF_BITS);
+		adc_disable_digital_buffer(schedule[i].channel & ADC_MUX_BITS);
+		adc_scan_table[0][i]= 0;
+		adc_scan_table[1][i]= 0;
+		adc_scan_divisor[i]= schedule[i].divisor;
+	}
+	adc_scan_count= count;
+	return ADC_OK;
+}
+
+/*
+Start the scanner. 'ADC_TRIGGER_FREE_RUNNING' runs the passes back to back ('pass_rate' is ignored).
+'ADC_TRIGGER_TIMER0_COMPARE_A'/ 'ADC_TRIGGER_TIMER1_COMPARE_B' start a pass 'pass_rate' times per second. The due entries of a pass are converted back to back.
+A pass must finish before the next trigger (see 'adc_schedule_get_overruns').
+Returns the actual pass rate in Hz (0 if free running or if the rate can't be reached).
+*/
+uint32_t adc_schedule_start(uint8_t trigger, uint32_t pass_rate){
+	if(adc_scan_count== 0 || adc_mux_owner!= ADC_MUX_OWNER_ADC){
+		return 0;
+	}
+	adc_scan_stop();
+	adc_stream_stop();
+	
+	for(uint8_t i= 0; i< adc_scan_count; i++){
+		adc_scan_countdown[i]= (i% adc_scan_divisor[i])+ 1;	//Stagger entries with equal divisors.
+	}
+	adc_scan_due= adc_scan_next_pass();
+	adc_scan_index= adc_scan_next_entry(0);
+	adc_scan_sum= 0;
+	adc_scan_samples= 0;
+	adc_scan_overruns= 0;
+	adc_scan_trigger= trigger;
+	
+	if(trigger!= ADC_TRIGGER_FREE_RUNNING){
+		pass_rate= adc_timer_start(trigger, pass_rate);
+		if(pass_rate== 0){
+			return 0;
+		}
+		ADCSRB= (ADCSRB & ~ADC_TRIGGER_SOURCE_BITS) | trigger;
+		adc_scan_pass_start= 1;
+	}else{
+		pass_rate= 0;
+		adc_scan_pass_start= 0;
+	}
+	
+	adc_set_resolution(ADC_RESOLUTION_10_BIT);	//The scanner stores right adjusted 10 bit results.
+	adc_mode= ADC_MODE_SCAN;
+	adc_scan_discard= adc_select(adc_scan_channels[adc_scan_index], 0);
+	ADCSRA|= ADC_INTERRUPT_FLAG;	//Clear a stale flag (cleared by writing a 1).
+	ADCSRA|= ADC_INTERRUPT_ENABLE;
+	sei();
+	if(trigger!= ADC_TRIGGER_FREE_RUNNING){
+		ADCSRA|= ADC_AUTO_TRIGGER_ENABLE;	//Conversions inside a pass are started manually.
+	}else{
+		ADCSRA|= ADC_START_CONVERSION;
+	}
+	return pass_rate;
+}
+
+/*
+Return the number of paced passes that didn't finish before the next trigger.
+*/
+uint16_t adc_schedule_get_overruns(void){
+	uint16_t temp;
+	cli();
+	temp= adc_scan_overruns;
+	sei();
+	return temp;
+}
@@ -8,6 +8,22 @@
  * Supports selectable AREF source.
  * Supports the inbuilt temperature sensor.
  * Uses right adjusted ADC readings.
+ * Supports an interrupt driven scanner which cycles through a channel list in the background.
+ * The scanner writes into a double buffered sample table. The latest complete pass can be read at any time without waiting.
+ * The scanner can follow a static schedule (rate divisor per entry) with passes paced by Timer 0 or Timer 1, so fast and slow channels share the ADC.
+ * Supports continuous acquisition of one channel (free running, Timer 0 compare A or Timer 1 compare B triggered) into a ring buffer.
+ * Timer triggered acquisition claims the timer through the timer resource manager. It fails if another driver holds it (Timer 0 is used by the Timer library).
+ * Requires the timer resource manager of the Timer library.
+ * Supports a fast 8 bit mode (left adjusted, only ADCH is read) with a faster prescaler profile. 10 bit reads switch back to the 10 bit prescaler.
+ * Supports oversampling and decimation (4^n conversions for n extra bits) for single reads and the scanner.
+ * Oversampled single reads can put the CPU in ADC noise reduction sleep mode during every conversion.
+ * Noise reduction sleep stops clk_I/O (Timer 0/1, synchronous Timer 2, USART, SPI). It is skipped while a driver holds one of those timers.
+ * Supports VCC measurement against the internal bandgap, and millivolt and temperature readings corrected by
+ * per-device calibration data (bandgap voltage, offset/ gain and temperature sensor) stored in the EEPROM. Integer math only.
+ * Tracks the active reference. Channels can carry reference bits (scan lists can mix references).
+ * Settling conversions are discarded only when the reference changes or an internal source (bandgap, temperature sensor) is selected.
+ * The input multiplexer can be handed to another peripheral (the analog comparator). The ADC is disabled while it doesn't own it.
+ * Supports window thresholds with hysteresis on scanner entries, evaluated in the ISR. State changes set event flags and can call a function.
  */ 
 
 
@@ -16,6 +32,12 @@
 
 //Includes.
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include <util/delay.h>
+#include "timerresource.h"
 
 //Attributes.
 #define ADC_PACKAGE_PDIP 0
@@ -50,17 +72,348 @@
 #endif
 #define ADC_CHANNEL_DESELECT 0xF0
 
+#define ADC_MUX_BITS 0x0F
+#define ADC_START_CONVERSION 0x40
+#define ADC_INTERRUPT_FLAG 0x10
+
+#define ADC_AUTO_TRIGGER_ENABLE 0x20
+#define ADC_LEFT_ADJUST 0x20
+#define ADC_TRIGGER_SOURCE_BITS 0x07
+
+//Operating modes.
+#define ADC_MODE_SINGLE 0
+#define ADC_MODE_SCAN 1
+#define ADC_MODE_STREAM 2
+#define ADC_MODE_OVERSAMPLE 3
+
+//Input multiplexer owners.
+#define ADC_MUX_OWNER_ADC 0
+#define ADC_MUX_OWNER_ANALOG_COMPARATOR 1
+
+//Oversampling.
+#define ADC_OVERSAMPLE_MAX_BITS 6		//16 bit results (4096 conversions).
+#define ADC_NOISE_REDUCTION_ENABLE 1
+#define ADC_NOISE_REDUCTION_DISABLE 0
+
+//Auto trigger sources (ADTS).
+#define ADC_TRIGGER_FREE_RUNNING 0x00
+#define ADC_TRIGGER_TIMER0_COMPARE_A 0x03
+#define ADC_TRIGGER_TIMER1_COMPARE_B 0x05
+
+#define ADC_RESOLUTION_10_BIT 0
+#define ADC_RESOLUTION_8_BIT 1
+#define ADC_PRESCALER_BITS 0x07
+
+//Fast 8 bit profile. 8 bit accuracy holds with ADC clocks up to about 1MHz (10 bit needs 50- 200kHz).
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#ifndef ADC_PRESCALER_FAST_8_BIT
+#if F_CPU> 8000000UL
+#define ADC_PRESCALER_FAST_8_BIT ADC_PRESCALER_16	//1MHz ADC clock, 77kHz sample rate at 16MHz.
+#elif F_CPU> 4000000UL
+#define ADC_PRESCALER_FAST_8_BIT ADC_PRESCALER_8
+#else
+#define ADC_PRESCALER_FAST_8_BIT ADC_PRESCALER_4
+#endif
+#endif
+
+//Ring buffer for continuous acquisition.
+#ifndef ADC_STREAM_BUFFER_SIZE
+#define ADC_STREAM_BUFFER_SIZE 128		//Bytes. Must be a power of two (maximum 256). 10 bit samples take 2 bytes, 8 bit samples take 1.
+#endif
+#define ADC_STREAM_BUFFER_MASK (ADC_STREAM_BUFFER_SIZE- 1)
+
+//Calibration.
+#define ADC_AREF_BITS 0xC0
+#define ADC_BANDGAP_NOMINAL 1100			//mV. 1.0- 1.2V depending on the device.
+#define ADC_GAIN_UNITY 16384				//2.14 fixed point.
+#define ADC_TEMPERATURE_RAW_25 353			//Temperature sensor reading at 25C (uncalibrated default).
+#define ADC_TEMPERATURE_SLOPE 24116			//Hundredths of a degree per LSB in 8.8 fixed point (130C over 138 LSB).
+#define ADC_CALIBRATION_SAMPLES 4			//Averaged conversions per calibration measurement. Must be a power of two.
+#ifndef ADC_REFERENCE_SETTLE_DELAY
+#define ADC_REFERENCE_SETTLE_DELAY 1000		//us. Time for the AREF capacitor after a reference change (blocking reads only).
+#endif
+#ifndef ADC_REFERENCE_SETTLE_CONVERSIONS
+#define ADC_REFERENCE_SETTLE_CONVERSIONS 2	//Conversions discarded after a reference change. Increase for a large AREF capacitor when scanning.
+#endif
+#define ADC_REFERENCE_UNKNOWN 0xFF
+#ifndef ADC_CALIBRATION_EEPROM_ADDRESS
+#define ADC_CALIBRATION_EEPROM_ADDRESS 0x0040	//Needs 'ADC_CALIBRATION_DATA_SIZE'+ 1 bytes.
+#endif
+
+//Scanner.
+#ifndef ADC_SCAN_MAX_CHANNELS
+#define ADC_SCAN_MAX_CHANNELS 8
+#endif
+#if ADC_SCAN_MAX_CHANNELS> 8
+#error "Threshold event flags hold 8 scanner entries."
+#endif
+
+//Container for a schedule entry.
+struct adc_schedules{
+	uint8_t channel;		//Can carry reference bits.
+	uint16_t divisor;		//Converted once every 'divisor' passes.
+};
+
+typedef struct adc_schedules adc_schedule_entry;
+
+//Threshold states.
+#define ADC_THRESHOLD_INSIDE 0
+#define ADC_THRESHOLD_BELOW 1
+#define ADC_THRESHOLD_ABOVE 2
+
 //Status and error codes.
 #define ADC_SINGLE_CONVERSION_PENDING 0x40
+#define ADC_OK 0
+#define ADC_ERROR 1
+#define ADC_CALIBRATION_DATA_SIZE 10
+
+//Container for the per-device calibration data.
+struct __attribute__((packed)) adc_calibrations{
+	uint16_t bandgap;				//Bandgap voltage in mV.
+	int16_t offset;					//Offset in LSB. Subtracted from raw readings.
+	uint16_t gain;					//Gain correction in 2.14 fixed point.
+	uint16_t temperature_raw;		//Temperature sensor reading at 25C.
+	uint16_t temperature_slope;		//Hundredths of a degree per LSB in 8.8 fixed point.
+};
+
+typedef struct adc_calibrations adc_calibration_container;
 
 //Functions.
 //Set up the ADC peripheral.
 void adc_set(uint8_t reference_voltage, uint8_t interrupt_enable, uint8_t prescaler);
-//Return a 10 bit ADC reading in single conversion mode.
+//Return a 10 bit ADC reading in single conversion mode. The channel can carry reference bits.
 uint16_t adc_read(uint8_t channel);
+//Return an 8 bit ADC reading in single conversion mode.
+uint8_t adc_read_8bit(uint8_t channel);
+//Select the 10 bit or the fast 8 bit prescaler profile.
+void adc_set_resolution(uint8_t resolution);
 //Disable the digital input buffer of a channel for power saving.
 void adc_disable_digital_buffer(uint8_t channel);
 //Return the temperature from the internal temperature sensor (in Celcius).
 uint16_t adc_read_temperature_sensor();
+//Return the calibrated temperature from the internal temperature sensor in hundredths of a degree Celsius.
+int16_t adc_read_temperature(void);
+//Measure VCC against the internal bandgap. Returns mV.
+uint16_t adc_read_vcc(void);
+//Return a calibrated reading of a channel in mV (AVCC reference).
+uint16_t adc_read_millivolts(uint8_t channel);
+//Apply the offset and gain correction to a raw reading.
+uint16_t adc_calibration_apply(uint16_t raw);
+//Load the calibration data from the EEPROM.
+uint8_t adc_calibration_load(void);
+//Store the calibration data in the EEPROM.
+void adc_calibration_save(void);
+//Restore the default (uncalibrated) calibration data.
+void adc_calibration_reset(void);
+//Calibrate the bandgap voltage against an externally measured VCC.
+void adc_calibrate_bandgap(uint16_t vcc);
+//Calibrate the offset and gain from two known points.
+uint8_t adc_calibrate_gain(uint16_t raw_low, uint16_t expected_low, uint16_t raw_high, uint16_t expected_high);
+//Calibrate the temperature sensor at a known temperature.
+void adc_calibrate_temperature(int16_t temperature);
+//Set the channel list of the scanner.
+uint8_t adc_scan_set(const uint8_t channels[], uint8_t count);
+//Start scanning in the background.
+void adc_scan_start(void);
+//Stop scanning after the current conversion.
+void adc_scan_stop(void);
+//Return the latest sample of a channel list entry.
+uint16_t adc_scan_read(uint8_t index);
+//Copy the latest complete pass of the channel list.
+void adc_scan_read_all(uint16_t values[]);
+//Return the number of completed passes (wraps around).
+uint8_t adc_scan_get_pass_count(void);
+//Set a static schedule (channel list with a rate divisor per entry).
+uint8_t adc_schedule_set(const adc_schedule_entry schedule[], uint8_t count);
+//Start the scanner with free running or timer paced passes. Returns the actual pass rate in Hz.
+uint32_t adc_schedule_start(uint8_t trigger, uint32_t pass_rate);
+//Return the number of paced passes that missed their trigger.
+uint16_t adc_schedule_get_overruns(void);
+//Set the number of extra bits the scanner adds by oversampling every entry.
+void adc_scan_set_oversampling(uint8_t extra_bits);
+//Set the window thresholds and hysteresis of a scanner entry.
+uint8_t adc_threshold_set(uint8_t index, uint16_t low, uint16_t high, uint16_t hysteresis);
+//Remove the thresholds of a scanner entry.
+void adc_threshold_clear(uint8_t index);
+//Return and clear the threshold event flags (bit per entry).
+uint8_t adc_threshold_get_events(void);
+//Return the threshold state of a scanner entry.
+uint8_t adc_threshold_get_state(uint8_t index);
+//Set a function called from the ISR on threshold state changes.
+void adc_threshold_set_callback(void (*callback)(uint8_t index, uint8_t state));
+//Return a 10+ n bit reading by oversampling and decimation. Noise reduction sleep is skipped while Timer 0, 1 or synchronous 2 is claimed.
+uint16_t adc_read_oversampled(uint8_t channel, uint8_t extra_bits, uint8_t noise_reduction);
+//Take the input multiplexer for another peripheral.
+uint8_t adc_mux_acquire(uint8_t owner);
+//Give the input multiplexer back to the ADC.
+void adc_mux_release(uint8_t owner);
+//Return the peripheral that owns the input multiplexer.
+uint8_t adc_mux_get_owner(void);
+
+//Start continuous acquisition of a channel into the ring buffer. Returns the actual sample rate in Hz.
+uint32_t adc_stream_start(uint8_t channel, uint8_t trigger, uint32_t sample_rate, uint8_t resolution);
+//Stop continuous acquisition.
+void adc_stream_stop(void);
+//Return the number of samples in the ring buffer.
+uint8_t adc_stream_available(void);
+//Pop the oldest sample from the ring buffer.
+uint8_t adc_stream_read(uint16_t *sample);
+//Return the number of samples dropped because the ring buffer was full.
+uint16_t adc_stream_get_overruns(void);
+
+//External variables.
+extern volatile uint8_t adc_mode;
+extern uint8_t adc_prescaler;
+extern uint8_t adc_reference;
+extern adc_calibration_container adc_calibration;
+extern uint16_t adc_vcc;
+
+/*
+Example implementation. Scan three channels in the background.
+
+#include "adc.h"
+
+int main(void)
+{
+	const uint8_t channels[]= {ADC_CHANNEL_0, ADC_CHANNEL_3, ADC_CHANNEL_5};
+	
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
+	adc_scan_set(channels, 3);
+	adc_scan_start();
+	
+	while (1)
+	{
+		uint16_t value= adc_scan_read(1);	//Latest sample of ADC_CHANNEL_3.
+		//Do stuff.
+	}
+}
+
+Example implementation. Schedule: current at 4kHz, voltage at 100Hz, temperature at 1Hz.
+
+#include "adc.h"
+
+int main(void)
+{
+	const adc_schedule_entry schedule[]= {
+		{ADC_CHANNEL_0, 1},		//Every pass.
+		{ADC_CHANNEL_1, 40},
+		{ADC_CHANNEL_2, 4000},
+	};
+	
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_64);	//Two conversions fit in a 250us pass.
+	adc_schedule_set(schedule, 3);
+	adc_schedule_start(ADC_TRIGGER_TIMER1_COMPARE_B, 4000);
+	
+	while (1)
+	{
+		uint16_t current= adc_scan_read(0);
+		//Do stuff.
+	}
+}
+
+Example implementation. Battery and overcurrent monitoring without polling.
+
+#include "adc.h"
+
+int main(void)
+{
+	const uint8_t channels[]= {ADC_CHANNEL_0, ADC_CHANNEL_1};	//Battery, current shunt.
+	
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
+	adc_scan_set(channels, 2);
+	adc_threshold_set(0, 600, 1023, 10);	//Low battery below 600.
+	adc_threshold_set(1, 0, 800, 20);		//Overcurrent above 800.
+	adc_scan_start();
+	
+	while (1)
+	{
+		uint8_t events= adc_threshold_get_events();
+		
+		if(events & (1<< 1)){
+			if(adc_threshold_get_state(1)== ADC_THRESHOLD_ABOVE){
+				//Shut down the load.
+			}
+		}
+		//Do stuff or sleep.
+	}
+}
+
+Example implementation. Scan with mixed references. Settling conversions are inserted only around the bandgap entry.
+
+#include "adc.h"
+
+int main(void)
+{
+	const uint8_t channels[]= {ADC_CHANNEL_0, ADC_CHANNEL_1, ADC_CHANNEL_2 | ADC_AREF_INTERNAL_BANDGAP};	//Small signal on channel 2.
+	
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);	//Default reference.
+	adc_scan_set(channels, 3);
+	adc_scan_start();
+	
+	while (1)
+	{
+		//Do stuff.
+	}
+}
+
+Example implementation. Calibrated battery monitor. Calibrate once against a multimeter, then use the EEPROM data.
+
+#include "adc.h"
+
+int main(void)
+{
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
+	if(adc_calibration_load()!= ADC_OK){
+		adc_calibrate_bandgap(4980);		//VCC measured with a multimeter.
+		adc_calibrate_temperature(2350);	//Room temperature is 23.5C.
+		adc_calibration_save();
+	}
+	
+	while (1)
+	{
+		uint16_t vcc= adc_read_vcc();						//mV.
+		uint16_t battery= adc_read_millivolts(ADC_CHANNEL_1);	//mV.
+		int16_t temperature= adc_read_temperature();		//Hundredths of a degree Celsius.
+		//Do stuff.
+	}
+}
+
+Example implementation. 12 bit load cell reading with the CPU asleep during conversions.
+
+#include "adc.h"
+
+int main(void)
+{
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
+	
+	while (1)
+	{
+		uint16_t value= adc_read_oversampled(ADC_CHANNEL_2, 2, ADC_NOISE_REDUCTION_ENABLE);	//0- 4095.
+		//Do stuff.
+	}
+}
+
+Example implementation. Sample a channel at 10kHz with 8 bit resolution.
+
+#include "adc.h"
+
+int main(void)
+{
+	uint16_t sample;
+	
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
+	adc_stream_start(ADC_CHANNEL_0, ADC_TRIGGER_TIMER1_COMPARE_B, 10000, ADC_RESOLUTION_8_BIT);	//Switches to the fast 8 bit profile.
+	
+	while (1)
+	{
+		while(adc_stream_read(&sample)== ADC_OK){
+			//Process the sample.
+		}
+	}
+}
+
+*/
 
 #endif /* ADC_H_ */
\ No newline at end of file
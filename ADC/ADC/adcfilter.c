@@ -0,0 +1,186 @@
+/*
+ * adcfilter.c
+ *
+ * Created: 19-Oct-26 2:14:21 PM
+ * Author: Ranul Deepanayake
+ */
+
+#include "adcfilter.h"
+
+/*
+Set up a boxcar filter with a window of 2^shift samples (up to 'ADC_FILTER_BOXCAR_MAX_SIZE').
+*/
+void adc_filter_boxcar_set(adc_filter_boxcar *filter, uint8_t shift){
+	if(shift> 15){
+		shift= 15;	//Keeps the shift below the width of the comparison.
+	}
+	while(shift && (1UL<< shift)> ADC_FILTER_BOXCAR_MAX_SIZE){
+		shift--;
+	}
+	filter->shift= shift;
+	filter->sum= 0;
+	filter->index= 0;
+	filter->primed= 0;
+}
+
+/*
+Feed a sample to a boxcar filter. Returns the rounded average of the window.
+The first sample fills the whole window so the output starts at the input instead of ramping up from 0.
+*/
+uint16_t adc_filter_boxcar_update(adc_filter_boxcar *filter, uint16_t sample){
+	uint8_t size= 1U<< filter->shift;
+	
+	if(!filter->primed){
+		for(uint8_t i= 0; i< size; i++){
+			filter->samples[i]= sample;
+		}
+		filter->sum= (uint32_t)sample<< filter->shift;
+		filter->primed= 1;
+	}
+	
+	filter->sum+= sample;
+	filter->sum-= filter->samples[filter->index];	//Running sum. Remove the oldest sample.
+	filter->samples[filter->index]= sample;
+	filter->index= (filter->index+ 1) & (size- 1);
+	
+	return (filter->sum+ ((1UL<< filter->shift)>> 1))>> filter->shift;
+}
+
+/*
+Set up an EMA filter with a coefficient of 1/ 2^shift (shift 1- 16). The time constant is about 2^shift samples.
+*/
+void adc_filter_ema_set(adc_filter_ema *filter, uint8_t shift){
+	if(shift> 16){
+		shift= 16;
+	}
+	filter->shift= shift;
+	filter->state= 0;
+	filter->primed= 0;
+}
+
+/*
+Feed a sample to an EMA filter. Returns the rounded filtered value.
+The state keeps 'ADC_FILTER_EMA_FRACTION_BITS' fraction bits so small steps are not lost to truncation.
+*/
+uint16_t adc_filter_ema_update(adc_filter_ema *filter, uint16_t sample){
+	uint32_t input= (uint32_t)sample<< ADC_FILTER_EMA_FRACTION_BITS;
+	
+	if(!filter->primed){
+		filter->state= input;
+		filter->primed= 1;
+	}
+	
+	if(input>= filter->state){
+		filter->state+= (input- filter->state)>> filter->shift;
+	}else{
+		filter->state-= (filter->state- input)>> filter->shift;	//Unsigned. Keep the shift on a positive difference.
+	}
+	
+	return (filter->state+ (1U<< (ADC_FILTER_EMA_FRACTION_BITS- 1)))>> ADC_FILTER_EMA_FRACTION_BITS;
+}
+
+/*
+Set up a 3 or 5 tap median filter. Any other value selects 3 taps.
+*/
+void adc_filter_median_set(adc_filter_median *filter, uint8_t taps){
+	filter->taps= (taps== 5)? 5: 3;
+	filter->index= 0;
+	filter->primed= 0;
+}
+
+/*
+Swap two values if they are out of order.
+*/
+static inline void adc_filter_sort(uint16_t *a, uint16_t *b){
+	if(*a> *b){
+		uint16_t temp= *a;
+		*a= *b;
+		*b= temp;
+	}
+}
+
+/*
+Feed a sample to a median filter. Returns the median of the last 3 or 5 samples.
+Uses fixed compare and swap networks (3 swaps for 3 taps, 7 for 5 taps).
+*/
+uint16_t adc_filter_median_update(adc_filter_median *filter, uint16_t sample){
+	uint16_t a, b, c, d, e;
+	
+	if(!filter->primed){
+		for(uint8_t i= 0; i< 5; i++){
+			filter->samples[i]= sample;
+		}
+		filter->primed= 1;
+	}
+	
+	filter->samples[filter->index]= sample;
+	if(++filter->index>= filter->taps){
+		filter->index= 0;
+	}
+	
+	a= filter->samples[0];
+	b= filter->samples[1];
+	c= filter->samples[2];
+	
+	if(filter->taps== 3){
+		adc_filter_sort(&a, &b);
+		adc_filter_sort(&b, &c);
+		adc_filter_sort(&a, &b);
+		return b;
+	}
+	
+	d= filter->samples[3];
+	e= filter->samples[4];
+	adc_filter_sort(&a, &b);
+	adc_filter_sort(&d, &e);
+	adc_filter_sort(&a, &d);	//a is the smallest. Drop it.
+	adc_filter_sort(&b, &e);	//e is the largest. Drop it.
+	adc_filter_sort(&b, &c);
+	adc_filter_sort(&c, &d);	//d is the largest of b, c, d.
+	adc_filter_sort(&b, &c);	//c is the median.
+	return c;
+}
+
+/*
+Set up a first order IIR filter. Coefficients are 2.14 fixed point ('ADC_FILTER_IIR_UNITY'= 1.0) within +/-1.0.
+Unity DC gain needs b_0+ b_1- a_1= 'ADC_FILTER_IIR_UNITY'.
+*/
+void adc_filter_iir_set(adc_filter_iir *filter, int16_t b_0, int16_t b_1, int16_t a_1){
+	filter->b_0= b_0;
+	filter->b_1= b_1;
+	filter->a_1= a_1;
+	filter->primed= 0;
+}
+
+/*
+Feed a sample to an IIR filter. Returns the rounded filtered value, clamped to 0- 65535.
+The output is fed back with 'ADC_FILTER_IIR_FRACTION_BITS' fraction bits. Inputs are limited to 15 bits to stay within 32 bits.
+*/
+uint16_t adc_filter_iir_update(adc_filter_iir *filter, uint16_t sample){
+	int32_t y= 0;
+	
+	if(sample> 0x7FFF){
+		sample= 0x7FFF;
+	}
+	if(!filter->primed){	//Start at the steady state of the first sample.
+		filter->x_1= sample;
+		filter->y_1= (int32_t)sample<< ADC_FILTER_IIR_FRACTION_BITS;
+		filter->primed= 1;
+	}
+	
+	//a_1* y_1 is split into the integer and fraction parts of y_1 to stay within 32 bits.
+	y= (int32_t)filter->b_0* sample+ (int32_t)filter->b_1* filter->x_1;
+	y-= (int32_t)filter->a_1* (filter->y_1>> ADC_FILTER_IIR_FRACTION_BITS);
+	y-= ((int32_t)filter->a_1* (filter->y_1 & (ADC_FILTER_IIR_UNITY- 1)))>> ADC_FILTER_IIR_FRACTION_BITS;
+	filter->x_1= sample;
+	filter->y_1= y;
+	
+	y= (y+ (1L<< (ADC_FILTER_IIR_FRACTION_BITS- 1)))>> ADC_FILTER_IIR_FRACTION_BITS;
+	if(y< 0){
+		return 0;
+	}
+	if(y> 0xFFFF){
+		return 0xFFFF;
+	}
+	return y;
+}
@@ -0,0 +1,119 @@
+/*
+ * adcfilter.h
+ *
+ * Created: 19-Oct-26 2:14:36 PM
+ * Author: Ranul Deepanayake
+ * Streaming fixed point filters for ADC samples: boxcar (moving average), EMA, 3/5 tap median and first order IIR.
+ * Every filter keeps its own state in a container, so any number of channels can be filtered independently.
+ * Each update takes constant time and uses no division (shifts only). Feed samples from 'adc_read', the scanner or 'adc_stream_read'.
+ * Inputs are unsigned samples up to 16 bits wide (10 bit readings or oversampled readings).
+ * Requires the ADC library.
+ */
+
+
+#ifndef ADCFILTER_H_
+#define ADCFILTER_H_
+
+//Includes.
+#include "adc.h"
+
+//Defines.
+#ifndef ADC_FILTER_BOXCAR_MAX_SIZE
+#define ADC_FILTER_BOXCAR_MAX_SIZE 16		//Largest boxcar window. Must be a power of two.
+#endif
+#define ADC_FILTER_EMA_FRACTION_BITS 8		//Fraction bits of the EMA state.
+#define ADC_FILTER_IIR_FRACTION_BITS 14		//IIR coefficients are 2.14 fixed point.
+#define ADC_FILTER_IIR_UNITY 16384
+
+//Container for a boxcar filter. Output is the average of the last 2^n samples.
+struct adc_filter_boxcars{
+	uint16_t samples[ADC_FILTER_BOXCAR_MAX_SIZE];
+	uint32_t sum;			//Running sum of the window.
+	uint8_t shift;			//Window is 2^shift samples.
+	uint8_t index;			//Oldest sample.
+	uint8_t primed;			//0 until the first sample fills the window.
+};
+
+//Container for an exponential moving average. y+= (x- y)/ 2^k.
+struct adc_filter_emas{
+	uint32_t state;			//Output in 'ADC_FILTER_EMA_FRACTION_BITS' fixed point.
+	uint8_t shift;			//k. Larger is smoother.
+	uint8_t primed;
+};
+
+//Container for a 3 or 5 tap median filter.
+struct adc_filter_medians{
+	uint16_t samples[5];
+	uint8_t taps;			//3 or 5.
+	uint8_t index;
+	uint8_t primed;
+};
+
+//Container for a first order IIR filter. y[n]= b0* x[n]+ b1* x[n- 1]- a1* y[n- 1].
+struct adc_filter_iirs{
+	int16_t b_0;			//2.14 fixed point coefficients.
+	int16_t b_1;
+	int16_t a_1;
+	uint16_t x_1;			//Previous input.
+	int32_t y_1;			//Previous output in 'ADC_FILTER_IIR_FRACTION_BITS' fixed point.
+	uint8_t primed;
+};
+
+typedef struct adc_filter_boxcars adc_filter_boxcar;
+typedef struct adc_filter_emas adc_filter_ema;
+typedef struct adc_filter_medians adc_filter_median;
+typedef struct adc_filter_iirs adc_filter_iir;
+
+//Functions.
+//Set up a boxcar filter with a window of 2^shift samples.
+void adc_filter_boxcar_set(adc_filter_boxcar *filter, uint8_t shift);
+//Feed a sample to a boxcar filter. Returns the filtered value.
+uint16_t adc_filter_boxcar_update(adc_filter_boxcar *filter, uint16_t sample);
+//Set up an EMA filter with a coefficient of 1/ 2^shift.
+void adc_filter_ema_set(adc_filter_ema *filter, uint8_t shift);
+//Feed a sample to an EMA filter. Returns the filtered value.
+uint16_t adc_filter_ema_update(adc_filter_ema *filter, uint16_t sample);
+//Set up a 3 or 5 tap median filter.
+void adc_filter_median_set(adc_filter_median *filter, uint8_t taps);
+//Feed a sample to a median filter. Returns the median of the last 3 or 5 samples.
+uint16_t adc_filter_median_update(adc_filter_median *filter, uint16_t sample);
+//Set up a first order IIR filter with 2.14 fixed point coefficients.
+void adc_filter_iir_set(adc_filter_iir *filter, int16_t b_0, int16_t b_1, int16_t a_1);
+//Feed a sample to an IIR filter. Returns the filtered value (clamped to 0- 65535).
+uint16_t adc_filter_iir_update(adc_filter_iir *filter, uint16_t sample);
+
+/*
+Example implementation. Spike rejection followed by smoothing on a 1kHz stream.
+
+#include "adc.h"
+#include "adcfilter.h"
+
+int main(void)
+{
+	adc_filter_median median;
+	adc_filter_ema ema;
+	uint16_t sample;
+	
+	adc_set(ADC_AREF_AVCC, ADC_INTERRUPT_DISABLE, ADC_PRESCALER_128);
+	adc_filter_median_set(&median, 5);
+	adc_filter_ema_set(&ema, 4);		//Time constant of about 16 samples.
+	adc_stream_start(ADC_CHANNEL_0, ADC_TRIGGER_TIMER1_COMPARE_B, 1000, ADC_RESOLUTION_10_BIT);
+	
+	while (1)
+	{
+		while(adc_stream_read(&sample)== ADC_OK){
+			uint16_t value= adc_filter_ema_update(&ema, adc_filter_median_update(&median, sample));
+			//Do stuff.
+		}
+	}
+}
+
+Example implementation. First order low pass IIR, y[n]= 0.1* x[n]+ 0.1* x[n- 1]+ 0.8* y[n- 1].
+
+	adc_filter_iir iir;
+	adc_filter_iir_set(&iir, 1638, 1638, -13107);	//a_1 is negative for a low pass.
+	value= adc_filter_iir_update(&iir, adc_read(ADC_CHANNEL_1));
+
+*/
+
+#endif /* ADCFILTER_H_ */
@@ -0,0 +1,92 @@
+/*
+ * analogcomparator.c
+ *
+ * Created: 19-Oct-26 3:40:52 PM
+ * Author: Ranul Deepanayake
+ */ 
+
+#include "analogcomparator.h"
+
+volatile uint8_t analog_comparator_events= 0;		//Edges since the last read.
+void (*analog_comparator_callback)(uint8_t output)= 0;	//Called from the ISR on every edge.
+
+/*
+Analog comparator interrupt. Counts the edge and calls the callback with the current output.
+*/
+ISR(ANALOG_COMP_vect){
+	analog_comparator_events++;
+	if(analog_comparator_callback){
+		analog_comparator_callback((ACSR & ANALOG_COMPARATOR_OUTPUT)? 1: 0);
+	}
+}
+
+/*
+Set up and enable the analog comparator.
+'negative_input' is 'ANALOG_COMPARATOR_NEGATIVE_AIN1' or an ADC channel (ADC_CHANNEL_0- ADC_CHANNEL_7). An ADC channel takes the ADC multiplexer.
+Returns 'ANALOG_COMPARATOR_ERROR' if the multiplexer is in use (the ADC is scanning or streaming).
+*/
+uint8_t analog_comparator_set(uint8_t positive_input, uint8_t negative_input, uint8_t interrupt_mode, uint8_t capture){
+	ACSR&= ~ANALOG_COMPARATOR_INTERRUPT_TOGGLE;	//Changing the edge select bits can raise an interrupt.
+	
+	if(negative_input== ANALOG_COMPARATOR_NEGATIVE_AIN1){
+		adc_mux_release(ADC_MUX_OWNER_ANALOG_COMPARATOR);
+		ADCSRB&= ~ANALOG_COMPARATOR_MUX_ENABLE;
+		DIDR1|= (1<< AIN1D);
+	}else{
+		if(negative_input> ANALOG_COMPARATOR_CHANNEL_MAX || adc_mux_acquire(ADC_MUX_OWNER_ANALOG_COMPARATOR)!= ADC_OK){
+			return ANALOG_COMPARATOR_ERROR;
+		}
+		ADMUX= (ADMUX & ~ADC_MUX_BITS) | negative_input;
+		ADCSRB|= ANALOG_COMPARATOR_MUX_ENABLE;	//The ADC is disabled, so the multiplexer feeds the comparator.
+		if(negative_input<= ADC_CHANNEL_5){
+			DIDR0|= (1<< negative_input);	//ADC6 and ADC7 have no digital input buffer.
+		}
+	}
+	if(positive_input== ANALOG_COMPARATOR_POSITIVE_AIN0){
+		DIDR1|= (1<< AIN0D);
+	}
+	
+	ACSR= positive_input | (interrupt_mode & ~ANALOG_COMPARATOR_INTERRUPT_TOGGLE) | capture;	//Enabled (ACD= 0), edge selected, interrupt off.
+	ACSR|= ANALOG_COMPARATOR_INTERRUPT_FLAG;	//Clear a stale flag (cleared by writing a 1).
+	analog_comparator_events= 0;
+	ACSR|= (interrupt_mode & ANALOG_COMPARATOR_INTERRUPT_TOGGLE);
+	return ANALOG_COMPARATOR_OK;
+}
+
+/*
+Disable the analog comparator (saves power) and give the multiplexer back to the ADC.
+*/
+void analog_comparator_stop(void){
+	ACSR&= ~(ANALOG_COMPARATOR_INTERRUPT_TOGGLE | ANALOG_COMPARATOR_CAPTURE_ENABLE);
+	ACSR|= ANALOG_COMPARATOR_DISABLE;
+	ADCSRB&= ~ANALOG_COMPARATOR_MUX_ENABLE;
+	adc_mux_release(ADC_MUX_OWNER_ANALOG_COMPARATOR);
+}
+
+/*
+Return the comparator output. 1 if the positive input is higher than the negative input.
+*/
+uint8_t analog_comparator_read(void){
+	return (ACSR & ANALOG_COMPARATOR_OUTPUT)? 1: 0;
+}
+
+/*
+Return and clear the number of edges since the last call. Wraps around after 255 edges.
+*/
+uint8_t analog_comparator_get_events(void){
+	uint8_t events;
+	cli();
+	events= analog_comparator_events;
+	analog_comparator_events= 0;
+	sei();
+	return events;
+}
+
+/*
+Set a function called from the ISR on every edge with the new output (0 to remove it). Keep it short.
+*/
+void analog_comparator_set_callback(void (*callback)(uint8_t output)){
+	cli();
+	analog_comparator_callback= callback;
+	sei();
+}
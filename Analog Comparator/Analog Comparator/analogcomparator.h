@@ -0,0 +1,95 @@
+/*
+ * analogcomparator.h
+ *
+ * Created: 19-Oct-26 3:41:08 PM
+ * Author: Ranul Deepanayake
+ * Analog comparator library for the ATmega328P.
+ * The positive input is AIN0 (PD6) or the internal bandgap. The negative input is AIN1 (PD7) or an ADC channel (ADC0- ADC7) through the ADC multiplexer.
+ * Using an ADC channel takes the multiplexer from the ADC library. The ADC is disabled until the comparator is stopped.
+ * Supports an interrupt on the rising, falling or both edges of the output. Edges are counted and can call a function.
+ * The output can trigger the Timer 1 input capture unit (ICP1) to timestamp edges in hardware. Timer 1 has to be set up separately.
+ * Requires the ADC library.
+ */ 
+
+
+#ifndef ANALOGCOMPARATOR_H_
+#define ANALOGCOMPARATOR_H_
+
+//Includes.
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "adc.h"
+
+//Attributes.
+#define ANALOG_COMPARATOR_POSITIVE_AIN0 0x00
+#define ANALOG_COMPARATOR_POSITIVE_BANDGAP 0x40		//ACBG.
+#define ANALOG_COMPARATOR_NEGATIVE_AIN1 0xFF		//Else an ADC channel (ADC_CHANNEL_0- ADC_CHANNEL_7).
+#define ANALOG_COMPARATOR_INTERRUPT_DISABLE 0x00
+#define ANALOG_COMPARATOR_INTERRUPT_TOGGLE 0x08		//ACIE with ACIS1:0.
+#define ANALOG_COMPARATOR_INTERRUPT_FALLING 0x0A
+#define ANALOG_COMPARATOR_INTERRUPT_RISING 0x0B
+#define ANALOG_COMPARATOR_CAPTURE_DISABLE 0x00
+#define ANALOG_COMPARATOR_CAPTURE_ENABLE 0x04		//ACIC. Connects the output to the Timer 1 input capture unit.
+
+#define ANALOG_COMPARATOR_DISABLE 0x80				//ACD.
+#define ANALOG_COMPARATOR_OUTPUT 0x20				//ACO.
+#define ANALOG_COMPARATOR_INTERRUPT_FLAG 0x10		//ACI.
+#define ANALOG_COMPARATOR_INTERRUPT_BITS 0x0B
+#define ANALOG_COMPARATOR_MUX_ENABLE 0x40			//ACME in ADCSRB.
+#define ANALOG_COMPARATOR_DIGITAL_BUFFERS 0x03		//AIN1D and AIN0D in DIDR1.
+#define ANALOG_COMPARATOR_CHANNEL_MAX 0x07
+
+//Status and error codes.
+#define ANALOG_COMPARATOR_OK 0
+#define ANALOG_COMPARATOR_ERROR 1
+
+//Functions.
+//Set up and enable the analog comparator.
+uint8_t analog_comparator_set(uint8_t positive_input, uint8_t negative_input, uint8_t interrupt_mode, uint8_t capture);
+//Disable the analog comparator and give the multiplexer back to the ADC.
+void analog_comparator_stop(void);
+//Return 1 if the positive input is higher than the negative input.
+uint8_t analog_comparator_read(void);
+//Return and clear the number of edges since the last call.
+uint8_t analog_comparator_get_events(void);
+//Set a function called from the ISR on every edge.
+void analog_comparator_set_callback(void (*callback)(uint8_t output));
+
+//External variables.
+extern volatile uint8_t analog_comparator_events;
+
+/*
+Example implementation. Overcurrent trip at 1.1V on a shunt connected to ADC3, without any ADC conversions.
+
+#include "adc.h"
+#include "analogcomparator.h"
+
+void overcurrent(uint8_t output){
+	if(!output){		//Shunt voltage above the bandgap (negative input higher).
+		PORTB&= ~0x01;	//Switch the load off.
+	}
+}
+
+int main(void)
+{
+	DDRB|= 0x01;
+	PORTB|= 0x01;
+	analog_comparator_set_callback(overcurrent);
+	analog_comparator_set(ANALOG_COMPARATOR_POSITIVE_BANDGAP, ADC_CHANNEL_3, ANALOG_COMPARATOR_INTERRUPT_FALLING, ANALOG_COMPARATOR_CAPTURE_DISABLE);
+	sei();
+	
+	while (1)
+	{
+		//Do stuff.
+	}
+}
+
+Example implementation. Zero crossing timestamps with the Timer 1 input capture unit (AIN0 vs AIN1).
+
+	analog_comparator_set(ANALOG_COMPARATOR_POSITIVE_AIN0, ANALOG_COMPARATOR_NEGATIVE_AIN1, ANALOG_COMPARATOR_INTERRUPT_DISABLE, ANALOG_COMPARATOR_CAPTURE_ENABLE);
+	TCCR1B= (1<< ICES1) | 0x02;		//Rising edges, prescaler 8.
+	//Read ICR1 when ICF1 is set in TIFR1, or enable ICIE1.
+
+*/
+
+#endif /* ANALOGCOMPARATOR_H_ */
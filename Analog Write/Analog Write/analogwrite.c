@@ -13,9 +13,21 @@ Selectable fixed frequencies.
 Selectable waveform and output compare modes.
 One timer module can operate only at one frequency for both output compare units.
 Phase correct PWM operates at half the frequency of fast PWM (defined frequencies are for fast PWM).
-Timers can't be used if being used for another purpose.
+Timers can't be used if being used for another purpose. Returns 'ANALOG_WRITE_ERROR' if another driver holds the timer or the output compare unit.
 */
-void analog_write_pwm_set(uint8_t timer, uint8_t frequency, uint8_t waveform, uint8_t ocr_mode){
+uint8_t analog_write_pwm_set(uint8_t timer, uint8_t frequency, uint8_t waveform, uint8_t ocr_mode){
+	uint8_t resources= TIMER_RESOURCE_BASE;
+	
+	if(ocr_mode & TIMER_COMPARE_A_OUTPUT_MODE_INVERTED){
+		resources|= TIMER_RESOURCE_COMPARE_A;
+	}
+	if(ocr_mode & TIMER_COMPARE_B_OUTPUT_MODE_INVERTED){
+		resources|= TIMER_RESOURCE_COMPARE_B;
+	}
+	if(timer_resource_claim(timer, resources, TIMER_OWNER_ANALOG_WRITE, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){	//'TIMER_0'- 'TIMER_2' match the resource manager.
+		return ANALOG_WRITE_ERROR;
+	}
+	
 	//Setting the prescaler bits according to the clock speeds and specified frequency.
 	if(F_CPU_VALUE== F_CPU_16_MHZ){
 		if(timer== TIMER_0){
@@ -106,6 +118,7 @@ void analog_write_pwm_set(uint8_t timer, uint8_t frequency, uint8_t waveform, ui
 	}else if(timer== TIMER_2){
 		TCCR2A|= ocr_mode;
 	}
+	return ANALOG_WRITE_OK;
 }
 
 /*
@@ -171,8 +184,13 @@ Prescaler is set to 1.
 Can't run while timer 1 is being used for another purpose.
 Duty cycle generation varies with the TOP value. Therefore experimentation is necessary to get the duty cycle range for a certain frequency (I couldn't figure out
 the equation).
+Returns 'ANALOG_WRITE_ERROR' if another driver holds Timer 1.
 */
-void analog_write_frequency_set(uint8_t waveform){
+uint8_t analog_write_frequency_set(uint8_t waveform){
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A, TIMER_OWNER_ANALOG_WRITE, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){
+		return ANALOG_WRITE_ERROR;
+	}
+	
 	if(waveform== TIMER16_FREQUENCY_WAVEFORM_GENERATION_CTC){
 		//Mode 12.
 		TCCR1A= 0x40;
@@ -192,6 +210,7 @@ void analog_write_frequency_set(uint8_t waveform){
 		TCNT1= 0x0000;
 		OCR1A= 0x0000;
 	}
+	return ANALOG_WRITE_OK;
 }
 
 /*
@@ -216,3 +235,23 @@ void analog_write_frequency_write(uint8_t waveform, uint32_t frequency, uint16_t
 	}
 }
 
+/*
+Disconnect the outputs of a timer, stop it and release it.
+*/
+void analog_write_stop(uint8_t timer){
+	switch(timer){
+		case TIMER_0:
+			TCCR0B= 0;
+			TCCR0A= 0;
+			break;
+		case TIMER_1:
+			TCCR1B= 0;
+			TCCR1A= 0;
+			break;
+		case TIMER_2:
+			TCCR2B= 0;
+			TCCR2A= 0;
+			break;
+	}
+	timer_resource_release(timer, TIMER_OWNER_ANALOG_WRITE);
+}
@@ -11,6 +11,7 @@
  * Timer 1 can be used for frequency generation (uses prescaler 1).
  * Please study the mode defines carefully.
  * The DDR registers of the respective OCR pins have to be set up to see an output on the pins.
+ * Timers are claimed through the timer resource manager. Setting up a timer held by another driver fails.
  */ 
 
 
@@ -19,6 +20,7 @@
 
 //Includes
 #include <avr/io.h>
+#include "timerresource.h"
 
 //Defines.
 #ifndef F_CPU
@@ -153,15 +155,21 @@
 #define TIMER16_FREQUENCY_WAVEFORM_GENERATION_PHASE_AND_FREQUENCY_CORRECT 1
 #define TIMER16_FREQUENCY_WAVEFORM_GENERATION_FAST 2
 
+//Status and error codes.
+#define ANALOG_WRITE_OK 0
+#define ANALOG_WRITE_ERROR 1
+
 //Functions.
 //Set up PWM on the specified port and OCR pin.
-void analog_write_pwm_set(uint8_t timer, uint8_t frequency, uint8_t waveform, uint8_t ocr_mode);
+uint8_t analog_write_pwm_set(uint8_t timer, uint8_t frequency, uint8_t waveform, uint8_t ocr_mode);
 //Write PWM value to output compare pin.
 void analog_write_pwm_write(uint8_t timer, uint8_t ocr, uint16_t duty_cycle);
 //Set up frequency generator.
-void analog_write_frequency_set(uint8_t waveform);
+uint8_t analog_write_frequency_set(uint8_t waveform);
 //Generate the specified frequency and duty cycle.
 void analog_write_frequency_write(uint8_t waveform, uint32_t frequency, uint16_t duty_cycle);
+//Stop a timer and release it.
+void analog_write_stop(uint8_t timer);
 
 /*
 Example implementation.
@@ -8,6 +8,83 @@
 
 int32_t bmp280_t_fine= 0;
 
+//Altitude in centimetres for pressure ratios (pressure/ sea level pressure) from 0.25 to 1.125 in steps of 1/128.
+//44330m* (1- ratio^(1/ 5.255)).
+const int32_t bmp280_altitude_table[BMP280_ALTITUDE_TABLE_SIZE] PROGMEM= {
+	1027909, 1007911, 988398, 969345, 950727, 932523, 914714, 897280,
+	880204, 863471, 847065, 830972, 815179, 799675, 784446, 769484,
+	754777, 740316, 726093, 712097, 698323, 684761, 671404, 658247,
+	645282, 632503, 619904, 607480, 595225, 583134, 571203, 559427,
+	547801, 536322, 524984, 513785, 502720, 491786, 480980, 470298,
+	459737, 449294, 438967, 428752, 418646, 408648, 398754, 388963,
+	379271, 369677, 360178, 350773, 341459, 332234, 323097, 314045,
+	305077, 296192, 287387, 278660, 270011, 261438, 252939, 244513,
+	236159, 227875, 219659, 211511, 203430, 195414, 187461, 179572,
+	171745, 163978, 156270, 148622, 141031, 133497, 126018, 118595,
+	111225, 103908, 96644, 89431, 82269, 75156, 68093, 61078,
+	54110, 47190, 40315, 33486, 26702, 19962, 13265, 6611,
+	0, -6570, -13098, -19586, -26034, -32443, -38813, -45144,
+	-51438, -57694, -63913, -70096, -76243, -82355, -88431, -94473,
+	-100481
+};
+
+#if BMP280_TRANSPORT== BMP280_TRANSPORT_SPI
+/*
+Read consecutive registers in a single burst. The register address auto-increments.
+*/
+uint8_t bmp280_read_registers(uint8_t register_address, uint8_t *data, uint8_t length){
+	BMP280_CS_LOW
+	spi_transfer(register_address | BMP280_SPI_READ);
+	spi_read_block(data, length);
+	BMP280_CS_HIGH
+	return BMP280_OK;
+}
+
+/*
+Write a single register.
+*/
+uint8_t bmp280_write_register(uint8_t register_address, uint8_t value){
+	BMP280_CS_LOW
+	spi_transfer(register_address & BMP280_SPI_WRITE);
+	spi_transfer(value);
+	BMP280_CS_HIGH
+	return BMP280_OK;
+}
+#else
+/*
+Read consecutive registers in a single burst. The register address auto-increments.
+Every byte except the last one is acknowledged.
+*/
+uint8_t bmp280_read_registers(uint8_t register_address, uint8_t *data, uint8_t length){
+	if(i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE)!= I2C_SUCCESS){
+		return BMP280_ERROR;
+	}
+	i2c_write(register_address);
+	if(i2c_delayed_start(BMP280_ADDRESS, I2C_READ)!= I2C_SUCCESS){
+		return BMP280_ERROR;
+	}
+	for(uint8_t i= 0; i< length- 1; i++){
+		data[i]= i2c_read_ack();
+	}
+	data[length- 1]= i2c_read_nack();
+	i2c_stop();
+	return BMP280_OK;
+}
+
+/*
+Write a single register.
+*/
+uint8_t bmp280_write_register(uint8_t register_address, uint8_t value){
+	if(i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE)!= I2C_SUCCESS){
+		return BMP280_ERROR;
+	}
+	i2c_write(register_address);
+	i2c_write(value);
+	i2c_stop();
+	return BMP280_OK;
+}
+#endif
+
 /*
 Set up the sensor with default settings.
 */
@@ -17,125 +94,120 @@ void bmp280_set_default(void){
 
 /*
 Set up the sensor with user specified settings.
+Sets up the slave select pin when the SPI transport is used.
+The configuration register is written first since writes to it may be ignored in normal mode.
 */
 void bmp280_set(uint8_t mode, uint8_t oversample_pressure, uint8_t oversample_temperature,  uint8_t iir_filter, uint8_t standby_time){
-	i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE);
-	i2c_write(BMP280_MEASUREMENT_CONTROL_REGISTER);
-	i2c_write(mode | oversample_pressure | oversample_temperature);
-	i2c_write(BMP280_CONFIGURATION_REGISTER);
-	i2c_write(iir_filter | standby_time);
-	i2c_stop();
+	#if BMP280_TRANSPORT== BMP280_TRANSPORT_SPI
+	BMP280_CS_HIGH
+	BMP280_CS_OUTPUT
+	#endif
+	bmp280_write_register(BMP280_CONFIGURATION_REGISTER, iir_filter | standby_time);
+	bmp280_write_register(BMP280_MEASUREMENT_CONTROL_REGISTER, mode | oversample_pressure | oversample_temperature);
 }
 
+#ifdef BMP280_EEPROM_CACHE
 /*
-Saves coefficient data in the host microcontroller.
-Must be called once before the first measurement. 
+CRC8 of the coefficient data. Used to validate the EEPROM cache.
 */
-void bmp280_get_coefficient_data(bmp280_coefficient_container *coefficents){
-	uint16_t temp_u= 0;
-	int16_t temp_s= 0;
-	
-	i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE);
-	i2c_write(BMP280_CALIB_00_LSB);
-	i2c_delayed_start(BMP280_ADDRESS, I2C_READ);
-	
-	//Get temperature coefficient data.
-	temp_u= i2c_read_ack();
-	coefficents->t_1= (i2c_read_ack()<< 8) | temp_u;
-	
-	temp_s= i2c_read_ack();
-	coefficents->t_2= (i2c_read_ack()<< 8) | temp_s;
-	
-	temp_s= i2c_read_ack();
-	coefficents->t_3= (i2c_read_nack()<< 8) | temp_s;
-	
-	//Get pressure coefficient data.
-	temp_u= i2c_read_ack();
-	coefficents->p_1= (i2c_read_ack()<< 8) | temp_u;
-	
-	temp_s= i2c_read_ack();
-	coefficents->p_2= (i2c_read_ack()<< 8) | temp_s;
-	
-	temp_s= i2c_read_ack();
-	coefficents->p_3= (i2c_read_ack()<< 8) | temp_s;
+static uint8_t bmp280_coefficient_crc(uint8_t *data){
+	uint8_t crc= 0;
+	for(uint8_t i= 0; i< BMP280_COEFFICIENT_DATA_SIZE; i++){
+		crc= _crc8_ccitt_update(crc, data[i]);
+	}
+	return crc;
+}
+
+/*
+Load coefficient data from the EEPROM cache. Returns 'BMP280_ERROR' if the cache is empty or corrupt.
+*/
+static uint8_t bmp280_coefficient_cache_read(bmp280_coefficient_container *coefficents){
+	uint8_t *data= (uint8_t *)coefficents;
 	
-	temp_s= i2c_read_ack();
-	coefficents->p_4= (i2c_read_ack()<< 8) | temp_s;
+	eeprom_read_block(data, (const void *)BMP280_EEPROM_CACHE_ADDRESS, BMP280_COEFFICIENT_DATA_SIZE);
+	if(coefficents->t_1== 0x0000 || coefficents->t_1== 0xFFFF){	//Erased EEPROM or a cleared cache.
+		return BMP280_ERROR;
+	}
+	if(eeprom_read_byte((const uint8_t *)(BMP280_EEPROM_CACHE_ADDRESS+ BMP280_COEFFICIENT_DATA_SIZE))!= bmp280_coefficient_crc(data)){
+		return BMP280_ERROR;
+	}
+	return BMP280_OK;
+}
+
+/*
+Store coefficient data in the EEPROM cache. Only changed bytes are written.
+*/
+static void bmp280_coefficient_cache_write(bmp280_coefficient_container *coefficents){
+	uint8_t *data= (uint8_t *)coefficents;
 	
-	temp_s= i2c_read_ack();
-	coefficents->p_5= (i2c_read_ack()<< 8) | temp_s;
+	eeprom_update_block(data, (void *)BMP280_EEPROM_CACHE_ADDRESS, BMP280_COEFFICIENT_DATA_SIZE);
+	eeprom_update_byte((uint8_t *)(BMP280_EEPROM_CACHE_ADDRESS+ BMP280_COEFFICIENT_DATA_SIZE), bmp280_coefficient_crc(data));
+}
+
+/*
+Invalidate the EEPROM coefficient cache. The next call to 'bmp280_get_coefficient_data' reads the sensor.
+*/
+void bmp280_clear_coefficient_cache(void){
+	eeprom_update_word((uint16_t *)BMP280_EEPROM_CACHE_ADDRESS, 0xFFFF);
+}
+#endif
+
+/*
+Saves coefficient data in the host microcontroller.
+Must be called once before the first measurement. 
+Waits for the sensor to finish copying its NVM, then reads all 24 bytes in a single burst.
+Uses the EEPROM cache instead of the sensor if 'BMP280_EEPROM_CACHE' is defined and the cache is valid.
+*/
+uint8_t bmp280_get_coefficient_data(bmp280_coefficient_container *coefficents){
+	uint8_t *data= (uint8_t *)coefficents;	//The container is packed in register order.
+	uint8_t watchdog_counter= 0;
 	
-	temp_s= i2c_read_ack();
-	coefficents->p_6= (i2c_read_ack()<< 8) | temp_s;
+	#ifdef BMP280_EEPROM_CACHE
+	if(bmp280_coefficient_cache_read(coefficents)== BMP280_OK){
+		return BMP280_OK;
+	}
+	#endif
 	
-	temp_s= i2c_read_ack();
-	coefficents->p_7= (i2c_read_ack()<< 8) | temp_s;
+	//Coefficient registers are invalid while the NVM is being copied (after power up or reset).
+	while(bmp280_get_nvs_load_status()){
+		_delay_us(BMP280_NVS_LOAD_POLL_DELAY);
+		watchdog_counter++;
+		if(watchdog_counter>= BMP280_NVS_LOAD_TIMEOUT){
+			return BMP280_ERROR;
+		}
+	}
 	
-	temp_s= i2c_read_ack();
-	coefficents->p_8= (i2c_read_ack()<< 8) | temp_s;
+	if(bmp280_read_registers(BMP280_CALIB_00_LSB, data, BMP280_COEFFICIENT_DATA_SIZE)!= BMP280_OK){
+		return BMP280_ERROR;
+	}
 	
-	temp_s= i2c_read_ack();
-	coefficents->p_9= (i2c_read_nack()<< 8) | temp_s;
+	#ifdef BMP280_EEPROM_CACHE
+	bmp280_coefficient_cache_write(coefficents);
+	#endif
 	
-	i2c_stop();
+	return BMP280_OK;
 }
 
 /*
-Get temperature as a float in Celsius with a resolution of two decimal places. Ex- 32.58C.
+Compensate a raw 20 bit temperature reading. Updates the 'bmp280_t_fine' global variable.
+Returns the temperature in hundredths of a degree Celsius.
 */
-float bmp280_get_temperature(bmp280_coefficient_container *coefficents){
-	int32_t temperature= 0, var_1= 0, var_2= 0;
-	uint8_t temp_msb= 0, temp_lsb= 0, temp_xlsb= 0;
-	float t= 0;
-	
-	i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE);
-	i2c_write(BMP280_TEMPERATURE_MSB);
-	i2c_delayed_start(BMP280_ADDRESS, I2C_READ);
-	temp_msb= i2c_read_ack();
-	temp_lsb= i2c_read_ack();
-	temp_xlsb= i2c_read_nack();
-	i2c_stop();
-	
-	//Formula from Adafruit's library.
-	temperature= temp_msb;
-	temperature= (temperature<< 8) | temp_lsb;
-	temperature= (temperature<< 8) | temp_xlsb;  
-	temperature= (temperature>> 4);
-	//temperature>>= 4; //GIves a bad reading.
+static int32_t bmp280_compensate_temperature(int32_t temperature, bmp280_coefficient_container *coefficents){
+	int32_t var_1= 0, var_2= 0;
 	
 	var_1= ((((temperature>> 3)- ((int32_t)coefficents->t_1 <<1)))* ((int32_t)coefficents->t_2))>> 11;
 	var_2= (((((temperature>> 4)- ((int32_t)coefficents->t_1))* ((temperature>> 4)- ((int32_t)coefficents->t_1)))>> 12)* ((int32_t) coefficents->t_3))>> 14;
 	bmp280_t_fine= var_1+ var_2;
-	t= (bmp280_t_fine* 5+ 128)>> 8;
-	return t/100;
+	return (bmp280_t_fine* 5+ 128)>> 8;
 }
 
 /*
-Get pressure as a float in Pa with a resolution of two decimal places. Ex- 97588.45Pa.
-Implicitly calls the temperature function to  update the 'bmp280_t_fine' global variable.
+Compensate a raw pressure reading using 'bmp280_t_fine'.
+Returns the pressure as an unsigned 24.8 fixed point integer in Pa.
 */
-float bmp280_get_pressure(bmp280_coefficient_container *coefficents){
-	int32_t pressure= 0; 
-	uint8_t pressure_msb= 0, pressure_lsb= 0, presure_xlsb= 0;
+static uint32_t bmp280_compensate_pressure(int32_t pressure, bmp280_coefficient_container *coefficents){
 	int64_t var_1= 0, var_2= 0, p= 0;
 	
-	bmp280_get_temperature(coefficents); //Has to be called to update the 'bmp280_t_fine' global variable. 
-	
-	i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE);
-	i2c_write(BMP280_PRESSURE_MSB);
-	i2c_delayed_start(BMP280_ADDRESS, I2C_READ);
-	pressure_msb= i2c_read_ack();
-	pressure_lsb= i2c_read_ack();
-	presure_xlsb= i2c_read_nack();
-	i2c_stop();
-	
-	//Formula from Adafruit's library.
-	pressure= pressure_msb;
-	pressure= (pressure<< 8) | pressure_lsb;
-	pressure= (pressure<< 8) | presure_xlsb;
-	pressure= (pressure>> 4);
-	pressure>>= 4;
-
 	var_1 = ((int64_t)bmp280_t_fine) - 128000;
 	var_2 = var_1 * var_1 * (int64_t)coefficents-> p_6;
 	var_2 = var_2 + ((var_1* (int64_t)coefficents-> p_5)<< 17);
@@ -154,7 +226,146 @@ float bmp280_get_pressure(bmp280_coefficient_container *coefficents){
 	var_2= (((int64_t)coefficents-> p_8)* p)>> 19;
 	p = ((p + var_1 + var_2) >> 8) + (((int64_t)coefficents-> p_7)<< 4);
 	
-	return (float)p/ 256;
+	return (uint32_t)p;
+}
+
+/*
+Get temperature as an integer in hundredths of a degree Celsius. Ex- 3258 (32.58C).
+Updates the 'bmp280_t_fine' global variable.
+*/
+int32_t bmp280_get_temperature_integer(bmp280_coefficient_container *coefficents){
+	int32_t temperature= 0;
+	uint8_t data[3];
+	
+	bmp280_read_registers(BMP280_TEMPERATURE_MSB, data, 3);
+	
+	//Formula from Adafruit's library.
+	temperature= data[0];
+	temperature= (temperature<< 8) | data[1];
+	temperature= (temperature<< 8) | data[2];  
+	temperature= (temperature>> 4);
+	//temperature>>= 4; //GIves a bad reading.
+	
+	return bmp280_compensate_temperature(temperature, coefficents);
+}
+
+/*
+Get temperature as a float in Celsius with a resolution of two decimal places. Ex- 32.58C.
+*/
+float bmp280_get_temperature(bmp280_coefficient_container *coefficents){
+	float t= bmp280_get_temperature_integer(coefficents);
+	return t/100;
+}
+
+/*
+Get pressure as an unsigned 24.8 fixed point integer in Pa. Ex- 24982643 (97588.45Pa). Divide by 256 for Pa.
+Reads pressure and temperature in a single burst and updates the 'bmp280_t_fine' global variable.
+*/
+uint32_t bmp280_get_pressure_integer(bmp280_coefficient_container *coefficents){
+	int32_t pressure= 0, temperature= 0;
+	uint8_t data[6];	//Pressure MSB, LSB, XLSB, temperature MSB, LSB, XLSB.
+	
+	bmp280_read_registers(BMP280_PRESSURE_MSB, data, 6);
+	
+	//Formula from Adafruit's library.
+	temperature= data[3];
+	temperature= (temperature<< 8) | data[4];
+	temperature= (temperature<< 8) | data[5];
+	temperature= (temperature>> 4);
+	bmp280_compensate_temperature(temperature, coefficents); //Has to be called to update the 'bmp280_t_fine' global variable. 
+	
+	pressure= data[0];
+	pressure= (pressure<< 8) | data[1];
+	pressure= (pressure<< 8) | data[2];
+	pressure= (pressure>> 4);
+	pressure>>= 4;
+	
+	return bmp280_compensate_pressure(pressure, coefficents);
+}
+
+/*
+Get pressure as a float in Pa with a resolution of two decimal places. Ex- 97588.45Pa.
+Implicitly calls the temperature function to  update the 'bmp280_t_fine' global variable.
+*/
+float bmp280_get_pressure(bmp280_coefficient_container *coefficents){
+	return (float)bmp280_get_pressure_integer(coefficents)/ 256;
+}
+
+/*
+Get altitude in centimetres from a pressure and a sea level pressure (both in Pa).
+Uses the altitude table with linear interpolation instead of 'pow()'. Error is below 10cm up to 2000m and below 50cm up to 9000m.
+Pressure ratios outside the table (about -1000m to 10000m) are clamped.
+Returns 'BMP280_ALTITUDE_ERROR' if either pressure is 0 (e.g. a failed read).
+*/
+int32_t bmp280_get_altitude(uint32_t pressure, uint32_t sea_level_pressure){
+	uint32_t ratio= 0, remainder= 0;
+	uint8_t index= 0;
+	uint16_t fraction= 0;
+	int32_t altitude_0= 0, altitude_1= 0;
+	
+	if(pressure== 0 || sea_level_pressure== 0){
+		return BMP280_ALTITUDE_ERROR;
+	}
+	if(pressure> BMP280_ALTITUDE_PRESSURE_MAX){
+		pressure= BMP280_ALTITUDE_PRESSURE_MAX;	//Keeps the shift below within 32 bits.
+	}
+	ratio= (pressure<< BMP280_ALTITUDE_RATIO_SHIFT)/ sea_level_pressure;	//Pressure ratio in Q15.
+	remainder= (pressure<< BMP280_ALTITUDE_RATIO_SHIFT)- (ratio* sea_level_pressure);
+	
+	if(ratio< BMP280_ALTITUDE_RATIO_MIN){
+		return (int32_t)pgm_read_dword(&bmp280_altitude_table[0]);
+	}
+	if(ratio>= BMP280_ALTITUDE_RATIO_MAX){
+		return (int32_t)pgm_read_dword(&bmp280_altitude_table[BMP280_ALTITUDE_TABLE_SIZE- 1]);
+	}
+	
+	ratio-= BMP280_ALTITUDE_RATIO_MIN;
+	index= ratio>> BMP280_ALTITUDE_RATIO_STEP_SHIFT;
+	fraction= ((ratio & (BMP280_ALTITUDE_RATIO_STEP- 1))<< 8) | ((remainder<< 8)/ sea_level_pressure);	//8 extra bits from the remainder.
+	altitude_0= (int32_t)pgm_read_dword(&bmp280_altitude_table[index]);
+	altitude_1= (int32_t)pgm_read_dword(&bmp280_altitude_table[index+ 1]);
+	
+	return altitude_0- (int32_t)(((uint32_t)(altitude_0- altitude_1)* fraction)>> (BMP280_ALTITUDE_RATIO_STEP_SHIFT+ 8));
+}
+
+/*
+Get the sea level pressure in Pa from a pressure (in Pa) measured at a known altitude (in centimetres).
+Inverse of 'bmp280_get_altitude'. Searches the altitude table and interpolates the pressure ratio.
+Usually called once at start up to calibrate against a known altitude.
+Returns 0 if the pressure is 0 (e.g. a failed read).
+*/
+uint32_t bmp280_get_sea_level_pressure(uint32_t pressure, int32_t altitude){
+	uint8_t low= 0, high= BMP280_ALTITUDE_TABLE_SIZE- 1, middle= 0;
+	int32_t altitude_0= 0, altitude_1= 0;
+	uint32_t ratio= 0;
+	
+	if(pressure== 0){
+		return 0;
+	}
+	
+	//The table is sorted by decreasing altitude. Find the interval that contains the altitude.
+	if(altitude>= (int32_t)pgm_read_dword(&bmp280_altitude_table[low])){
+		high= low+ 1;
+		altitude= (int32_t)pgm_read_dword(&bmp280_altitude_table[low]);
+	}else if(altitude<= (int32_t)pgm_read_dword(&bmp280_altitude_table[high])){
+		low= high- 1;
+		altitude= (int32_t)pgm_read_dword(&bmp280_altitude_table[high]);
+	}
+	while(high- low> 1){
+		middle= (low+ high)>> 1;
+		if(altitude> (int32_t)pgm_read_dword(&bmp280_altitude_table[middle])){
+			high= middle;
+		}else{
+			low= middle;
+		}
+	}
+	
+	altitude_0= (int32_t)pgm_read_dword(&bmp280_altitude_table[low]);
+	altitude_1= (int32_t)pgm_read_dword(&bmp280_altitude_table[high]);
+	ratio= (BMP280_ALTITUDE_RATIO_MIN<< 8)+ ((uint32_t)low<< (BMP280_ALTITUDE_RATIO_STEP_SHIFT+ 8));	//Q23.
+	ratio+= (((uint32_t)(altitude_0- altitude)<< (BMP280_ALTITUDE_RATIO_STEP_SHIFT+ 8))+ ((altitude_0- altitude_1)>> 1))/ (uint32_t)(altitude_0- altitude_1);	//Rounded.
+	
+	return (((uint64_t)pressure<< (BMP280_ALTITUDE_RATIO_SHIFT+ 8))+ (ratio>> 1))/ ratio;	//64 bit division. Not meant for the measurement loop.
 }
 
 /*
@@ -162,11 +373,7 @@ Get the device ID (0x58).
 */
 uint8_t bmp280_get_device_id(void){
 	uint8_t chip_id= 0;
-	i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE);
-	i2c_write(BMP280_CHIP_ID_REGISTER);
-	i2c_delayed_start(BMP280_ADDRESS, I2C_READ);
-	chip_id= i2c_read_nack();
-	i2c_stop();
+	bmp280_read_registers(BMP280_CHIP_ID_REGISTER, &chip_id, 1);
 	return chip_id;
 }
 
@@ -174,10 +381,7 @@ uint8_t bmp280_get_device_id(void){
 Reset the sensor.
 */
 void bmp280_reset(void){
-	i2c_delayed_start(BMP280_ADDRESS, I2C_WRITE);
-	i2c_write(BMP280_RESET_REGISTER);
-	i2c_write(BMP280_RESET_VALUE);
-	i2c_stop();
+	bmp280_write_register(BMP280_RESET_REGISTER, BMP280_RESET_VALUE);
 }
 
 /*
@@ -194,8 +398,10 @@ uint8_t bmp280_get_measurement_status(void){
 }
 
 /*
-Under development.
+Returns 'BMP280_STATUS_IM_UPDATE' while NVM data is being copied to the image registers, 0 when done.
 */
 uint8_t bmp280_get_nvs_load_status(void){
-	return 0;
+	uint8_t status= 0;
+	bmp280_read_registers(BMP280_STATUS_REGISTER, &status, 1);
+	return status & BMP280_STATUS_IM_UPDATE;
 }
\ No newline at end of file
@@ -3,21 +3,62 @@
  *
  * Created: 04-Nov-18 9:10:11 AM
  * Author: Ranul Deepanayake
- * BOSCH BMP280 library for the ATmega328P using I2C.
+ * BOSCH BMP280 library for the ATmega328P using I2C or SPI (selected with 'BMP280_TRANSPORT').
+ * The SPI transport requires the SPI library and supports clocks up to 10MHz. Set up the SPI peripheral in mode 0 or 3.
  * Supports selectable sensor configuration options.
- * Returns temperature and pressure as floats.
+ * Returns temperature and pressure as floats. Pressure is also available as a 24.8 fixed point integer.
+ * Converts pressure to altitude (and back) with an integer lookup table.
  * The pressure function implicitly calls the temperature function to  update the 'bmp280_t_fine' global variable.
  * Saves coefficient data in the host microcontroller.
+ * Coefficient data is read in a single burst once the sensor has finished copying its NVM.
+ * Coefficient data can optionally be cached in the host EEPROM (define 'BMP280_EEPROM_CACHE').
  */ 
 
 #ifndef BMP280_H_
 #define BMP280_H_
 
-#include "i2c.h"
+#include <util/delay.h>
+#include <avr/pgmspace.h>
 
 //Defines.
+#define BMP280_TRANSPORT_I2C 0
+#define BMP280_TRANSPORT_SPI 1
+#ifndef BMP280_TRANSPORT
+#define BMP280_TRANSPORT BMP280_TRANSPORT_I2C	//Change to 'BMP280_TRANSPORT_SPI' for SPI.
+#endif
+
+#if BMP280_TRANSPORT== BMP280_TRANSPORT_SPI
+#include "spi.h"
+#else
+#include "i2c.h"
+#endif
+
 #define BMP280_ADDRESS 0x76
 
+//SPI slave select pin.
+#ifndef BMP280_CS_DDR_REGISTER
+#define BMP280_CS_DDR_REGISTER DDRB		//Default is PORTB.
+#endif
+#ifndef BMP280_CS_PORT_REGISTER
+#define BMP280_CS_PORT_REGISTER PORTB	//Default is PORTB.
+#endif
+#ifndef BMP280_CS_PIN
+#define BMP280_CS_PIN (1<<1)			//Default is PB1.
+#endif
+#define BMP280_CS_OUTPUT (BMP280_CS_DDR_REGISTER|= BMP280_CS_PIN);
+#define BMP280_CS_LOW (BMP280_CS_PORT_REGISTER&= ~BMP280_CS_PIN);
+#define BMP280_CS_HIGH (BMP280_CS_PORT_REGISTER|= BMP280_CS_PIN);
+#define BMP280_SPI_READ 0x80	//Bit 7 of the register address selects read.
+#define BMP280_SPI_WRITE 0x7F	//Mask for writes.
+//#define BMP280_EEPROM_CACHE	//Uncomment to cache coefficient data in the host EEPROM.
+#ifdef BMP280_EEPROM_CACHE
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#endif
+#ifndef BMP280_EEPROM_CACHE_ADDRESS
+#define BMP280_EEPROM_CACHE_ADDRESS 0x0000	//Needs 'BMP280_COEFFICIENT_DATA_SIZE'+ 1 bytes.
+#endif
+
 //Configuration registers.
 #define BMP280_STATUS_REGISTER 0xF3
 #define BMP280_MEASUREMENT_CONTROL_REGISTER 0xF4
@@ -27,6 +68,11 @@
 
 #define BMP280_RESET_VALUE 0xB6
 
+#define BMP280_STATUS_IM_UPDATE 0x01	//Set while NVM data is being copied to the image registers.
+#define BMP280_STATUS_MEASURING 0x08	//Set while a conversion is running.
+#define BMP280_NVS_LOAD_TIMEOUT 250		//Number of 'BMP280_NVS_LOAD_POLL_DELAY' polls before giving up.
+#define BMP280_NVS_LOAD_POLL_DELAY 10	//Microseconds.
+
 #define BMP280_MODE_SLEEP 0x00
 #define BMP280_MODE_FORCED 0x01
 #define BMP280_MODE_NORMAL 0x03
@@ -95,9 +141,25 @@
 #define BMP280_CALIB_11_MSB 0x9F
 #define BMP280_CALIB_12_LSB 0xA0	//Reserved. Should this be read??
 #define BMP280_CALIB_12_MSB 0xA1
+#define BMP280_COEFFICIENT_DATA_SIZE 24	//dig_T1 to dig_P9.
 
-//Container for coefficient data.
-struct bmp280_coefficients{
+//Altitude conversion.
+#define BMP280_SEA_LEVEL_PRESSURE 101325UL	//Standard atmosphere in Pa.
+#define BMP280_ALTITUDE_TABLE_SIZE 113
+#define BMP280_ALTITUDE_RATIO_SHIFT 15		//Pressure ratios are Q15 (32768= 1.0).
+#define BMP280_ALTITUDE_RATIO_STEP_SHIFT 8	//Table step of 256 (1/128).
+#define BMP280_ALTITUDE_RATIO_STEP (1<< BMP280_ALTITUDE_RATIO_STEP_SHIFT)
+#define BMP280_ALTITUDE_RATIO_MIN 8192UL	//0.25.
+#define BMP280_ALTITUDE_RATIO_MAX (BMP280_ALTITUDE_RATIO_MIN+ ((uint32_t)(BMP280_ALTITUDE_TABLE_SIZE- 1)<< BMP280_ALTITUDE_RATIO_STEP_SHIFT))	//1.125.
+#define BMP280_ALTITUDE_PRESSURE_MAX 131071UL	//Largest pressure in Pa that can be shifted into Q15.
+
+//Status and error codes.
+#define BMP280_OK 0
+#define BMP280_ERROR 1
+#define BMP280_ALTITUDE_ERROR INT32_MIN	//Returned by 'bmp280_get_altitude' for a zero pressure. 'bmp280_get_sea_level_pressure' returns 0.
+
+//Container for coefficient data. Packed in register order (little endian) so that it can be filled in a single burst.
+struct __attribute__((packed)) bmp280_coefficients{
 	//Temperature.
 	uint16_t t_1;
 	int16_t t_2;
@@ -119,18 +181,31 @@ typedef struct bmp280_coefficients bmp280_coefficient_container;
 
 //Global variables.
 extern int32_t bmp280_t_fine;
+extern const int32_t bmp280_altitude_table[BMP280_ALTITUDE_TABLE_SIZE];
 
 //Functions.
+//Read consecutive registers in a single burst.
+uint8_t bmp280_read_registers(uint8_t register_address, uint8_t *data, uint8_t length);
+//Write a single register.
+uint8_t bmp280_write_register(uint8_t register_address, uint8_t value);
 //Set up the sensor with default settings.
 void bmp280_set_default(void);
 //Set up the sensor with user specified settings.
 void bmp280_set(uint8_t mode, uint8_t oversample_pressure, uint8_t oversample_temperature,  uint8_t iir_filter, uint8_t standby_time);
 //Saves coefficient data in the host microcontroller. Must be called once before the first measurement.
-void bmp280_get_coefficient_data(bmp280_coefficient_container *coefficents);
+uint8_t bmp280_get_coefficient_data(bmp280_coefficient_container *coefficents);
 //Get temperature as a float in Celsius.
 float bmp280_get_temperature(bmp280_coefficient_container *coefficents);
+//Get temperature as an integer in hundredths of a degree Celsius.
+int32_t bmp280_get_temperature_integer(bmp280_coefficient_container *coefficents);
 //Get pressure as a float in Pa.
 float bmp280_get_pressure(bmp280_coefficient_container *coefficents);
+//Get pressure as a 24.8 fixed point integer in Pa.
+uint32_t bmp280_get_pressure_integer(bmp280_coefficient_container *coefficents);
+//Get altitude in centimetres from pressure and sea level pressure in Pa. Returns 'BMP280_ALTITUDE_ERROR' if either is 0.
+int32_t bmp280_get_altitude(uint32_t pressure, uint32_t sea_level_pressure);
+//Get sea level pressure in Pa from pressure in Pa and altitude in centimetres. Returns 0 if the pressure is 0.
+uint32_t bmp280_get_sea_level_pressure(uint32_t pressure, int32_t altitude);
 //Get the device ID (0x58).
 uint8_t bmp280_get_device_id(void);
 //Reset the sensor.
@@ -139,8 +214,12 @@ void bmp280_reset(void);
 void bmp280_force_measurement(void);
 //Under development.
 uint8_t bmp280_get_measurement_status(void);
-//Under development.
+//Returns 'BMP280_STATUS_IM_UPDATE' while NVM data is being copied, 0 when done.
 uint8_t bmp280_get_nvs_load_status(void);
+#ifdef BMP280_EEPROM_CACHE
+//Invalidate the EEPROM coefficient cache. Call after replacing the sensor.
+void bmp280_clear_coefficient_cache(void);
+#endif
 
 /*
 Example implementation.
@@ -154,12 +233,35 @@ int main(void)
 
 	i2c_set(I2C_BAUD_RATE(I2C_SCL_CLOCK));
 	bmp280_set(BMP280_MODE_NORMAL, BMP280_OVERSAMPLE_PRESSURE_X16, BMP280_OVERSAMPLE_TEMPERATURE_X2, BMP280_FILTER_2, BMP280_STANDBY_250_MS);
-	bmp280_get_coefficient_data(coefficients);
+	if(bmp280_get_coefficient_data(coefficients)!= BMP280_OK){
+		//Handle error.
+	}
 	
 	while (1)
 	{
 		float temperature= bmp280_get_temperature(coefficients);
 		float pressure= bmp280_get_pressure(coefficients);
+		int32_t altitude= bmp280_get_altitude(bmp280_get_pressure_integer(coefficients)>> 8, BMP280_SEA_LEVEL_PRESSURE);	//Centimetres.
+	}
+}
+
+Example implementation using SPI.
+
+//Define 'BMP280_TRANSPORT' as 'BMP280_TRANSPORT_SPI' in the header 'bmp280.h' or as a compiler flag.
+#include "spi.h"
+#include "bmp280.h"
+
+int main(void)
+{
+	bmp280_coefficient_container coefficients;
+
+	spi_set(SPI_MODE_0, SPI_MSB_FIRST, SPI_CLOCK_DIV_2);	//8MHz.
+	bmp280_set(BMP280_MODE_NORMAL, BMP280_OVERSAMPLE_PRESSURE_X2, BMP280_OVERSAMPLE_TEMPERATURE_X1, BMP280_FILTER_OFF, BMP280_STANDBY_0_5_MS);
+	bmp280_get_coefficient_data(&coefficients);
+	
+	while (1)
+	{
+		uint32_t pressure= bmp280_get_pressure_integer(&coefficients);	//Single 6 byte burst.
 	}
 }
 
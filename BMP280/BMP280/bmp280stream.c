@@ -0,0 +1,111 @@
+/*
+ * bmp280stream.c
+ *
+ * Created: 19-Oct-26 10:12:21 AM
+ * Author: Ranul Deepanayake
+ */
+
+#include "bmp280stream.h"
+
+struct bmp280_streams bmp280_stream[BMP280_STREAM_COUNT];	//Output streams.
+
+/*
+Set the decimation factor of a stream (1- 'BMP280_STREAM_MAX_FACTOR'). A factor of 0 disables the stream.
+Clears accumulated and unread samples of the stream.
+*/
+void bmp280_stream_set(uint8_t stream, uint16_t factor){
+	if(stream>= BMP280_STREAM_COUNT){
+		return;
+	}
+	if(factor> BMP280_STREAM_MAX_FACTOR){
+		factor= BMP280_STREAM_MAX_FACTOR;
+	}
+
+	bmp280_stream[stream].factor= factor;
+	bmp280_stream[stream].count= 0;
+	bmp280_stream[stream].temperature_sum= 0;
+	bmp280_stream[stream].pressure_sum= 0;
+	bmp280_stream[stream].head= 0;
+	bmp280_stream[stream].available= 0;
+	bmp280_stream[stream].stored= 0;
+}
+
+/*
+Read the sensor once and feed the sample to every stream.
+The pressure read updates 'bmp280_t_fine', so temperature is derived from it without a second transaction.
+*/
+void bmp280_stream_update(bmp280_coefficient_container *coefficents){
+	uint32_t pressure= bmp280_get_pressure_integer(coefficents);
+	bmp280_stream_push((bmp280_t_fine* 5+ 128)>> 8, pressure);
+}
+
+/*
+Feed a sample to every stream. Constant time per stream.
+Temperature in hundredths of a degree Celsius, pressure in 24.8 fixed point Pa.
+*/
+void bmp280_stream_push(int32_t temperature, uint32_t pressure){
+	for(uint8_t i= 0; i< BMP280_STREAM_COUNT; i++){
+		struct bmp280_streams *stream= &bmp280_stream[i];
+
+		if(stream->factor== 0){
+			continue;	//Disabled.
+		}
+
+		stream->temperature_sum+= temperature;
+		stream->pressure_sum+= pressure>> BMP280_STREAM_PRESSURE_SUM_SHIFT;
+		stream->count++;
+
+		if(stream->count>= stream->factor){	//Block complete. Write the average into the ring.
+			stream->ring[stream->head].temperature= stream->temperature_sum/ (int32_t)stream->factor;
+			stream->ring[stream->head].pressure= ((stream->pressure_sum+ (stream->factor>> 1))/ stream->factor)<< BMP280_STREAM_PRESSURE_SUM_SHIFT;
+			stream->head= (stream->head+ 1) & BMP280_STREAM_RING_MASK;
+			if(stream->available< BMP280_STREAM_RING_SIZE){
+				stream->available++;	//Else the oldest sample has been overwritten.
+			}
+			if(stream->stored< BMP280_STREAM_RING_SIZE){
+				stream->stored++;
+			}
+
+			stream->count= 0;
+			stream->temperature_sum= 0;
+			stream->pressure_sum= 0;
+		}
+	}
+}
+
+/*
+Returns the number of unread averaged samples in a stream.
+*/
+uint8_t bmp280_stream_available(uint8_t stream){
+	if(stream>= BMP280_STREAM_COUNT){
+		return 0;
+	}
+	return bmp280_stream[stream].available;
+}
+
+/*
+Pops the oldest unread averaged sample of a stream.
+Returns 'BMP280_ERROR' if there are no unread samples.
+*/
+uint8_t bmp280_stream_read(uint8_t stream, bmp280_stream_sample *sample){
+	if(bmp280_stream_available(stream)== 0){
+		return BMP280_ERROR;
+	}
+
+	*sample= bmp280_stream[stream].ring[(bmp280_stream[stream].head- bmp280_stream[stream].available) & BMP280_STREAM_RING_MASK];
+	bmp280_stream[stream].available--;
+	return BMP280_OK;
+}
+
+/*
+Copies the most recent averaged sample of a stream without consuming it.
+Returns 'BMP280_ERROR' if the stream hasn't produced a sample yet.
+*/
+uint8_t bmp280_stream_latest(uint8_t stream, bmp280_stream_sample *sample){
+	if(stream>= BMP280_STREAM_COUNT || bmp280_stream[stream].stored== 0){
+		return BMP280_ERROR;
+	}
+
+	*sample= bmp280_stream[stream].ring[(bmp280_stream[stream].head- 1) & BMP280_STREAM_RING_MASK];
+	return BMP280_OK;
+}
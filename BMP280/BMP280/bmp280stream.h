@@ -0,0 +1,101 @@
+/*
+ * bmp280stream.h
+ *
+ * Created: 19-Oct-26 10:12:40 AM
+ * Author: Ranul Deepanayake
+ * Multi-rate decimating averager for the BMP280 library.
+ * The sensor is read once per update and every stream averages its own block of samples (boxcar decimation).
+ * Each stream keeps a ring of its most recent averaged samples. The oldest sample is overwritten when a ring is full.
+ * Uses integer math only. Temperature is in hundredths of a degree Celsius, pressure is 24.8 fixed point in Pa.
+ * Requires the BMP280 library.
+ */
+
+
+#ifndef BMP280STREAM_H_
+#define BMP280STREAM_H_
+
+//Includes.
+#include "bmp280.h"
+
+//Defines.
+#ifndef BMP280_STREAM_COUNT
+#define BMP280_STREAM_COUNT 2			//Number of output streams. Change according to the required rates.
+#endif
+#ifndef BMP280_STREAM_RING_SIZE
+#define BMP280_STREAM_RING_SIZE 8		//Must be a power of two.
+#endif
+#define BMP280_STREAM_RING_MASK (BMP280_STREAM_RING_SIZE- 1)
+#define BMP280_STREAM_PRESSURE_SUM_SHIFT 4	//Pressure is summed in 28.4 fixed point to leave headroom for large factors.
+#define BMP280_STREAM_MAX_FACTOR 2048		//Largest number of samples averaged into one output sample.
+
+//Container for an averaged sample.
+struct bmp280_stream_samples{
+	int32_t temperature;	//Hundredths of a degree Celsius.
+	uint32_t pressure;		//24.8 fixed point in Pa.
+};
+
+typedef struct bmp280_stream_samples bmp280_stream_sample;
+
+//Container for the state of one output stream.
+struct bmp280_streams{
+	uint16_t factor;		//Input samples per output sample. 0 disables the stream.
+	uint16_t count;			//Input samples accumulated so far.
+	int32_t temperature_sum;
+	uint32_t pressure_sum;
+	bmp280_stream_sample ring[BMP280_STREAM_RING_SIZE];
+	uint8_t head;			//Next slot to write.
+	uint8_t available;		//Unread samples in the ring.
+	uint8_t stored;			//Samples in the ring, read or unread.
+};
+
+//External variables.
+extern struct bmp280_streams bmp280_stream[BMP280_STREAM_COUNT];
+
+//Functions.
+//Set the decimation factor of a stream. Clears the stream.
+void bmp280_stream_set(uint8_t stream, uint16_t factor);
+//Read the sensor once and feed the sample to every stream. Call at the sensor output data rate.
+void bmp280_stream_update(bmp280_coefficient_container *coefficents);
+//Feed an externally obtained sample to every stream.
+void bmp280_stream_push(int32_t temperature, uint32_t pressure);
+//Returns the number of unread averaged samples in a stream.
+uint8_t bmp280_stream_available(uint8_t stream);
+//Pops the oldest unread averaged sample of a stream.
+uint8_t bmp280_stream_read(uint8_t stream, bmp280_stream_sample *sample);
+//Copies the most recent averaged sample of a stream without consuming it.
+uint8_t bmp280_stream_latest(uint8_t stream, bmp280_stream_sample *sample);
+
+/*
+Example implementation. Sensor at 50Hz, 25Hz control stream and 1Hz logging stream.
+
+#include "i2c.h"
+#include "bmp280.h"
+#include "bmp280stream.h"
+
+int main(void)
+{
+	bmp280_coefficient_container coefficients;
+	bmp280_stream_sample sample;
+
+	i2c_set(I2C_BAUD_RATE(I2C_SCL_CLOCK));
+	bmp280_set(BMP280_MODE_NORMAL, BMP280_OVERSAMPLE_PRESSURE_X4, BMP280_OVERSAMPLE_TEMPERATURE_X1, BMP280_FILTER_OFF, BMP280_STANDBY_0_5_MS);
+	bmp280_get_coefficient_data(&coefficients);
+	bmp280_stream_set(0, 2);	//25Hz.
+	bmp280_stream_set(1, 50);	//1Hz.
+
+	while (1)
+	{
+		bmp280_stream_update(&coefficients);	//Every 20ms.
+
+		if(bmp280_stream_read(0, &sample)== BMP280_OK){
+			//Control loop.
+		}
+		if(bmp280_stream_read(1, &sample)== BMP280_OK){
+			//Logging.
+		}
+	}
+}
+
+*/
+
+#endif /* BMP280STREAM_H_ */
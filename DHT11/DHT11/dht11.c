@@ -7,6 +7,82 @@
 
 #include "dht11.h"
 
+#ifdef DHT11_CAPTURE_ENABLE
+volatile uint8_t dht11_capture_state= DHT11_IDLE;		//Status of the interrupt driven capture.
+volatile uint8_t dht11_capture_data[DHT11_NUM_BYTES];	//Bytes decoded by the interrupt driven capture.
+volatile uint8_t dht11_capture_edges= 0;				//Falling edges seen so far.
+volatile uint8_t dht11_capture_last_edge= 0;			//Timer 2 count at the last falling edge.
+volatile uint8_t dht11_capture_overflows= 0;			//Timer 2 overflows since the last falling edge.
+
+uint8_t dht11_state= DHT11_STATE_IDLE;			//State of the non-blocking measurement.
+uint32_t dht11_start_time= 0;					//Millisecond timestamp of the last start signal.
+uint8_t dht11_started= 0;						//Set after the first start signal.
+uint8_t dht11_cache[DHT11_NUM_BYTES];			//Last good reading.
+uint8_t dht11_cache_valid= 0;
+#endif
+
+/*
+Compare the sum of the first four bytes with the checksum byte.
+*/
+static uint8_t dht11_checksum(volatile uint8_t data[]){
+	uint8_t result= 0;
+	for(uint8_t i= 0; i< DHT11_NUM_BYTES- 1; i++){
+		result+= data[i];	//Add first four bytes together. Overflow is discarded.
+	}
+	if(result!= data[DHT11_CHECKSUM_BYTE]){
+		return DHT11_ERROR;
+	}
+	return DHT11_OK;
+}
+
+#ifdef DHT11_CAPTURE_ENABLE
+/*
+Stop the capture and release Timer 2 and the pin change interrupt.
+*/
+static void dht11_capture_stop(uint8_t status){
+	DHT11_PCMSK_REGISTER&= ~DHT11_PIN;
+	TIMSK2= 0;
+	TCCR2B= 0;
+	timer_resource_release(TIMER_RESOURCE_TIMER_2, TIMER_OWNER_DHT11);
+	dht11_capture_state= status;
+}
+
+/*
+Decodes one bit per falling edge from the time since the previous falling edge.
+Every bit is a 50 microsecond low pulse followed by a 26- 28 microsecond ('0') or 70 microsecond ('1') high pulse.
+*/
+ISR(DHT11_PCINT_vect){
+	uint8_t now= TCNT2;
+	uint8_t period= 0, bit= 0;
+	
+	if(DHT11_PIN_INPUT_HIGH || dht11_capture_state!= DHT11_BUSY){
+		return;		//Rising edge or another pin on the port.
+	}
+	
+	period= now- dht11_capture_last_edge;	//Unsigned arithmetic handles the counter wrapping.
+	dht11_capture_last_edge= now;
+	dht11_capture_overflows= 0;
+	
+	if(dht11_capture_edges>= DHT11_CAPTURE_RESPONSE_EDGES){
+		bit= dht11_capture_edges- DHT11_CAPTURE_RESPONSE_EDGES;
+		dht11_capture_data[bit>> 3]= (dht11_capture_data[bit>> 3]<< 1) | (period> DHT11_CAPTURE_BIT_THRESHOLD);	//MSB first.
+	}
+	
+	if(++dht11_capture_edges>= DHT11_CAPTURE_EDGES){
+		dht11_capture_stop(dht11_checksum(dht11_capture_data));
+	}
+}
+
+/*
+Watchdog for the interrupt driven capture. Gives up if the sensor stops sending edges.
+*/
+ISR(TIMER2_OVF_vect){
+	if(++dht11_capture_overflows>= DHT11_CAPTURE_TIMEOUT_OVERFLOWS){
+		dht11_capture_stop(DHT11_ERROR);
+	}
+}
+#endif
+
 /*
 Initiates communication with the DHT11 sensor and obtains measurements.
 Uses a bit banged single wire custom serial communications protocol.
@@ -80,25 +156,79 @@ uint8_t dht11_measure(uint8_t data[]){
 	}
 	
 	//Calculate checksum and compare with received checksum to detect corrupt data.
-	uint16_t result= 0;
-	for(uint8_t i= 0; i< DHT11_NUM_BYTES- 1; i++){
-		result+= data[i];	//Add first four bytes together.
+	return dht11_checksum(data);
+}
+
+#ifdef DHT11_CAPTURE_ENABLE
+/*
+Sends the start signal and decodes the response in the background.
+Poll 'dht11_capture_status' for the result. The CPU is only interrupted on the edges of the response.
+*/
+void dht11_capture_start(void){
+	DHT11_PIN_OUTPUT
+	DHT11_PIN_HIGH
+	DHT11_PIN_WAIT_MILLISECONDS(DHT11_STABILIZE_PULSE_TIME)
+	DHT11_PIN_LOW
+	DHT11_PIN_WAIT_MILLISECONDS(DHT11_START_PULSE_TIME)
+	dht11_capture_arm();
+}
+
+/*
+Releases the line after the start pulse and decodes the response in the background.
+Sets up Timer 2 (free running) and the pin change interrupt of the sensor pin.
+The capture fails with 'DHT11_ERROR' if another driver holds Timer 2.
+*/
+void dht11_capture_arm(void){
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_2, TIMER_RESOURCE_BASE, TIMER_OWNER_DHT11, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){
+		DHT11_PIN_HIGH
+		DHT11_PIN_INPUT
+		dht11_capture_state= DHT11_ERROR;
+		return;
 	}
-	if(result!= data[DHT11_CHECKSUM_BYTE]){	//Compare result with checksum byte and return status code.
-		return DHT11_ERROR;
-	}else{
-		return DHT11_OK;
+	
+	for(uint8_t i= 0; i< DHT11_NUM_BYTES; i++){
+		dht11_capture_data[i]= 0;
+	}
+	dht11_capture_edges= 0;
+	dht11_capture_overflows= 0;
+	dht11_capture_state= DHT11_BUSY;
+	
+	TCCR2A= 0;	//Normal mode.
+	TCNT2= 0;
+	dht11_capture_last_edge= 0;
+	TIFR2= DHT11_CAPTURE_TIMER_OVERFLOW_INTERRUPT;	//Clear a stale overflow flag.
+	TIMSK2= DHT11_CAPTURE_TIMER_OVERFLOW_INTERRUPT;
+	TCCR2B= DHT11_CAPTURE_TIMER_PRESCALER;
+	
+	DHT11_PIN_HIGH
+	DHT11_PIN_INPUT		//Release the line. The sensor responds with a falling edge.
+	PCICR|= DHT11_PCICR_BANK;
+	DHT11_PCMSK_REGISTER|= DHT11_PIN;
+	sei();
+}
+
+/*
+Returns 'DHT11_BUSY' while the capture is running, 'DHT11_IDLE' if none was started, 'DHT11_OK' or 'DHT11_ERROR' when done.
+Copies the decoded bytes into an array of size 'DHT11_NUM_BYTES' when the capture succeeded.
+*/
+uint8_t dht11_capture_status(uint8_t data[]){
+	uint8_t status= dht11_capture_state;
+	
+	if(status== DHT11_OK){
+		for(uint8_t i= 0; i< DHT11_NUM_BYTES; i++){
+			data[i]= dht11_capture_data[i];
+		}
 	}
+	return status;
 }
+#endif
 
 /*
 Returns the relative air humidity as a float percentage.
 Requires an array of the size 'DHT11_NUM_BYTES' as an argument. 
 */
 float dht11_get_humidity(uint8_t data[]){
-	float integer= (float) data[DHT11_HUMIDITY_INT_BYTE];
-	float decimal= (float) data[DHT11_HUMIDITY_DEC_BYTE];
-	return ((integer* 10)+ decimal)/10;
+	return (float)dht11_get_humidity_fixed(data)/ 10;
 }
 
 /*
@@ -106,12 +236,11 @@ Returns the ambient air temperature as a float value according to the specified
 Requires an array of the size 'DHT11_NUM_BYTES' as an argument.
 */
 float dht11_get_temperature(uint8_t unit, uint8_t data[]){
-	float integer= (float) data[DHT11_TEMPERATURE_INT_BYTE];
-	float decimal= (float) data[DHT11_TEMPERATURE_DEC_BYTE];
 	if(unit== DHT11_CELCIUS){
-		return ((integer* 10)+ decimal)/10;
+		return (float)dht11_get_temperature_fixed(DHT11_CELCIUS, data)/ 10;
 	}else{
-		return (((((integer* 10)+ decimal)* 90)/50)+ 320)/ 10;		//Celcius to farenheit conversion. 
+		int16_t temperature= dht11_get_temperature_fixed(DHT11_CELCIUS, data);
+		return (float)((temperature* 9)+ 1600)/ 50;		//Celcius to farenheit conversion. Single float division.
 	}
 }
 
@@ -136,8 +265,9 @@ void dht11_get_temperature_integer(uint8_t unit, uint8_t data[], uint8_t tempera
 		temperature[1]= data[DHT11_TEMPERATURE_DEC_BYTE];
 	}
 	else{
-		temperature[0]= (((float) data[DHT11_TEMPERATURE_INT_BYTE])* 1.8)+ 32;
-		temperature[1]= (((float) data[DHT11_TEMPERATURE_DEC_BYTE])* 1.8)+ 32;
+		int16_t farenheit= dht11_get_temperature_fixed(DHT11_FARENHEIT, data);
+		temperature[0]= farenheit/ 10;
+		temperature[1]= farenheit% 10;
 	}
 }
 
@@ -181,3 +311,162 @@ float dht11_get_heat_index(uint8_t unit, uint8_t data[]){
 	return heat_index;
 }
 
+/*
+Returns the relative air humidity in tenths of a percent. Ex- 455 (45.5%).
+Requires an array of the size 'DHT11_NUM_BYTES' as an argument.
+*/
+int16_t dht11_get_humidity_fixed(uint8_t data[]){
+	return (data[DHT11_HUMIDITY_INT_BYTE]* 10)+ data[DHT11_HUMIDITY_DEC_BYTE];
+}
+
+/*
+Returns the ambient air temperature in tenths of a degree according to the specified measurement unit. Ex- 235 (23.5C).
+Requires an array of the size 'DHT11_NUM_BYTES' as an argument.
+*/
+int16_t dht11_get_temperature_fixed(uint8_t unit, uint8_t data[]){
+	int16_t temperature= (data[DHT11_TEMPERATURE_INT_BYTE]* 10)+ data[DHT11_TEMPERATURE_DEC_BYTE];
+	if(unit== DHT11_CELCIUS){
+		return temperature;
+	}
+	return ((temperature* 9+ 2)/ 5)+ 320;	//Celcius to farenheit conversion (rounded).
+}
+
+/*
+Integer square root of a 32 bit value (bit by bit).
+*/
+static uint16_t dht11_sqrt(uint32_t value){
+	uint32_t result= 0, bit= 1UL<< 30;
+	
+	while(bit> value){
+		bit>>= 2;
+	}
+	while(bit){
+		if(value>= result+ bit){
+			value-= result+ bit;
+			result= (result>> 1)+ bit;
+		}else{
+			result>>= 1;
+		}
+		bit>>= 2;
+	}
+	return result;
+}
+
+/*
+Returns the heat index in tenths of a degree according to the specified measurement unit. Ex- 312 (31.2C).
+Same algorithm as 'dht11_get_heat_index' (Steadman & Rothfusz) evaluated in fixed point without floats or 'pow()'.
+Temperature and humidity are Q6 (1/64 of a degree and percent). The regression is evaluated as P0(R)+ T* (P1(R)+ T* P2(R)).
+Requires an array of the size 'DHT11_NUM_BYTES' as an argument.
+*/
+int16_t dht11_get_heat_index_fixed(uint8_t unit, uint8_t data[]){
+	int32_t temperature= ((int32_t)dht11_get_temperature_fixed(DHT11_CELCIUS, data)* DHT11_FIXED_CELCIUS_TO_FARENHEIT_Q6+ 2048)>> 12;	//Q6 farenheit without the offset.
+	int32_t humidity= ((int32_t)dht11_get_humidity_fixed(data)* DHT11_FIXED_TENTHS_TO_Q6+ 2048)>> 12;	//Q6 percent.
+	int32_t heat_index= 0, p_0= 0, p_1= 0, p_2= 0;
+	
+	temperature+= DHT11_FIXED_32_Q6;
+	
+	//Simple formula. 1.1T- 10.3+ 0.047RH.
+	heat_index= ((temperature* DHT11_FIXED_SIMPLE_T_Q16+ humidity* DHT11_FIXED_SIMPLE_RH_Q16)>> 16)+ DHT11_FIXED_SIMPLE_OFFSET_Q6;
+	
+	if(heat_index> DHT11_FIXED_79_Q6){
+		//P2(R)= c5+ c7R+ c9R^2 in Q20.
+		p_2= (DHT11_FIXED_C7_Q30+ ((humidity* DHT11_FIXED_C9_Q32)>> 8))>> 4;	//Q26.
+		p_2= (DHT11_FIXED_C5_Q26+ ((humidity* p_2)>> 6))>> 6;				//Q20.
+		//P1(R)= c2+ c4R+ c8R^2 in Q26.
+		p_1= DHT11_FIXED_C4_Q26+ ((humidity* DHT11_FIXED_C8_Q26)>> 6);
+		p_1= DHT11_FIXED_C2_Q26+ (humidity* (p_1>> 6));						//Q26.
+		//P0(R)= c1+ c3R+ c6R^2 in Q18.
+		p_0= DHT11_FIXED_C3_Q18+ ((humidity* DHT11_FIXED_C6_Q18)>> 6);
+		p_0= DHT11_FIXED_C1_Q18+ (humidity* (p_0>> 6));
+		
+		heat_index= (p_1+ temperature* p_2+ 8192)>> 14;						//P1+ T* P2 in Q12.
+		heat_index= (p_0+ temperature* heat_index+ 2048)>> 12;				//Q6.
+		
+		//Adjustments.
+		if(humidity< DHT11_FIXED_13_Q6 && temperature>= DHT11_FIXED_80_Q6 && temperature<= DHT11_FIXED_112_Q6){
+			//-((13- RH)/ 4)* sqrt((17- |T- 95|)/ 17).
+			int32_t distance= temperature- DHT11_FIXED_95_Q6;
+			if(distance< 0){
+				distance= -distance;
+			}
+			uint16_t root= dht11_sqrt((((uint32_t)(DHT11_FIXED_17_Q6- distance))<< 16)/ 17);	//Q11.
+			heat_index-= ((DHT11_FIXED_13_Q6- humidity)* root)>> 13;
+		}else if(humidity> DHT11_FIXED_85_Q6 && temperature>= DHT11_FIXED_80_Q6 && temperature<= DHT11_FIXED_87_Q6){
+			//((RH- 85)/ 10)* ((87- T)/ 5).
+			heat_index+= ((humidity- DHT11_FIXED_85_Q6)* (DHT11_FIXED_87_Q6- temperature)* 41)>> 17;	//0.02 from Q12 to Q6.
+		}
+	}
+	
+	//Convert F to C if specified and Q6 to tenths.
+	if(unit== DHT11_CELCIUS){
+		return ((heat_index- DHT11_FIXED_32_Q6)* DHT11_FIXED_Q6_FARENHEIT_TO_CELCIUS_TENTHS+ 32768)>> 16;
+	}
+	return (heat_index* 10+ 32)>> 6;
+}
+
+#ifdef DHT11_CAPTURE_ENABLE
+/*
+Starts a non-blocking measurement by pulling the line low. Doesn't wait for the start pulse.
+Returns 'DHT11_BUSY' if a measurement is running or if less than 'DHT11_MINIMUM_INTERVAL' milliseconds have passed since the last one.
+*/
+uint8_t dht11_start(void){
+	uint32_t now= timer_get_millis();
+	
+	if(dht11_state!= DHT11_STATE_IDLE){
+		return DHT11_BUSY;
+	}
+	if(dht11_started && now- dht11_start_time< DHT11_MINIMUM_INTERVAL){
+		return DHT11_BUSY;
+	}
+	
+	DHT11_PIN_OUTPUT
+	DHT11_PIN_LOW
+	dht11_start_time= now;
+	dht11_started= 1;
+	dht11_state= DHT11_STATE_START_PULSE;
+	return DHT11_OK;
+}
+
+/*
+Advances a non-blocking measurement. Call from the main loop.
+Releases the line once the start pulse is long enough and collects the result of the background capture.
+Returns 'DHT11_BUSY' while a measurement is running.
+Returns 'DHT11_OK' once with a new reading when a measurement succeeds.
+Otherwise copies the last good reading and returns 'DHT11_CACHED' (the last measurement failed or no new one has finished), or 'DHT11_ERROR' if there is none yet.
+Readings are copied into an array of size 'DHT11_NUM_BYTES'.
+*/
+uint8_t dht11_poll(uint8_t data[]){
+	uint8_t status= 0;
+	
+	if(dht11_state== DHT11_STATE_START_PULSE){
+		if(timer_get_millis()- dht11_start_time< DHT11_START_PULSE_TIME){
+			return DHT11_BUSY;
+		}
+		dht11_capture_arm();
+		dht11_state= DHT11_STATE_CAPTURE;
+	}
+	
+	if(dht11_state== DHT11_STATE_CAPTURE){
+		status= dht11_capture_status(dht11_cache);	//Only written on success.
+		if(status== DHT11_BUSY){
+			return DHT11_BUSY;
+		}
+		dht11_state= DHT11_STATE_IDLE;
+		if(status== DHT11_OK){
+			dht11_cache_valid= 1;
+		}else{
+			status= DHT11_CACHED;
+		}
+	}else{
+		status= DHT11_CACHED;
+	}
+	
+	if(!dht11_cache_valid){
+		return DHT11_ERROR;
+	}
+	for(uint8_t i= 0; i< DHT11_NUM_BYTES; i++){
+		data[i]= dht11_cache[i];
+	}
+	return status;
+}
+#endif
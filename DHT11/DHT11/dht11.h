@@ -4,11 +4,18 @@
  * Created: 15-Jan-19 9:25:23 AM
  * Author : Ranul Deepanayake
  * DHT11 sensor library for the ATmega 328P. Works on all GPIO ports and pins.
- * The sensor requires a minimum 2 second delay between polls. 
+ * The sensor requires a minimum 1 second delay between polls ('DHT11_MINIMUM_INTERVAL'). 
  * Supports ambient air temperature, relative air humidity and heat index measurement.
  * Supports integer and float results. 
  * Supports error detection through a checksum.
  * Requires 'F_CPU'. 
+ * Supports interrupt driven decoding ('DHT11_CAPTURE_ENABLE'). Bits are classified from the time between falling edges (pin change interrupt and Timer 2).
+ * Timer 2 and the pin change interrupt of the sensor port are used only while a capture is running. Timer 2 is claimed through the timer resource manager.
+ * The capture defines the pin change ISR of the sensor port ('DHT11_PCINT_vect') and the Timer 2 overflow ISR. 
+ * The Rotary Encoder library also defines PCINT2_vect (PORTD). Move the sensor to another port to use both.
+ * Supports non-blocking measurements ('dht11_start'/ 'dht11_poll') which enforce the minimum sampling interval and cache the last good reading.
+ * Cached readings are reported with 'DHT11_CACHED', new ones with 'DHT11_OK'.
+ * The capture and non-blocking measurements require the Timer library ('timer_set_millis' for non-blocking measurements). The blocking API doesn't.
  */ 
 
 
@@ -19,8 +26,13 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include <stdlib.h>
+#include <avr/interrupt.h>
 
 //Constant attributes and functions.
+//#define DHT11_CAPTURE_ENABLE			//Uncomment (or define in the compiler flags) for interrupt driven captures and non-blocking measurements.
+#ifdef DHT11_CAPTURE_ENABLE
+#include "timer.h"
+#endif
 #ifndef DHT11_DDR_REGISTER 
 #define DHT11_DDR_REGISTER DDRD			//Default is PORTD.
 #endif
@@ -33,6 +45,15 @@
 #ifndef DHT11_PIN
 #define DHT11_PIN (1<<7) 				//Default is pin 8.
 #endif
+#ifndef DHT11_PCICR_BANK
+#define DHT11_PCICR_BANK 0x04			//Default is PCIE2 (PORTD).
+#endif
+#ifndef DHT11_PCMSK_REGISTER
+#define DHT11_PCMSK_REGISTER PCMSK2		//Default is PCMSK2 (PORTD).
+#endif
+#ifndef DHT11_PCINT_vect
+#define DHT11_PCINT_vect PCINT2_vect	//Default is PCINT2_vect (PORTD).
+#endif
 #define DHT11_PIN_HIGH (DHT11_PORT_REGISTER|= DHT11_PIN);
 #define DHT11_PIN_LOW (DHT11_PORT_REGISTER&= ~DHT11_PIN);
 #define DHT11_PIN_OUTPUT (DHT11_DDR_REGISTER|= DHT11_PIN);
@@ -54,9 +75,54 @@
 #define DHT11_START_PULSE_TIME 20
 #define DHT11_LOW_PULSE_MAX_TIME 30
 
+//Interrupt driven capture.
+#define DHT11_CAPTURE_TIMER_PRESCALER 0x03		//Timer 2 prescaler 32. 2 microsecond ticks, overflows every 512 microseconds.
+#define DHT11_CAPTURE_TIMER_OVERFLOW_INTERRUPT 0x01
+#define DHT11_CAPTURE_BIT_THRESHOLD 50			//Ticks between falling edges. '0'- 78 microseconds, '1'- 120 microseconds.
+#define DHT11_CAPTURE_RESPONSE_EDGES 2			//Falling edges of the response signal before the first bit.
+#define DHT11_CAPTURE_EDGES (DHT11_CAPTURE_RESPONSE_EDGES+ (DHT11_NUM_BYTES* 8))
+#define DHT11_CAPTURE_TIMEOUT_OVERFLOWS 2		//Timer 2 overflows without an edge before giving up.
+
+//Fixed point heat index. Temperature and humidity are Q6, coefficients are scaled as named.
+#define DHT11_FIXED_CELCIUS_TO_FARENHEIT_Q6 47186	//(1.8* 64/ 10)* 4096. Tenths of a degree celcius to Q6 farenheit.
+#define DHT11_FIXED_TENTHS_TO_Q6 26214				//(64/ 10)* 4096.
+#define DHT11_FIXED_Q6_FARENHEIT_TO_CELCIUS_TENTHS 5689	//(5/ 9)* (10/ 64)* 65536.
+#define DHT11_FIXED_SIMPLE_T_Q16 72090				//1.1.
+#define DHT11_FIXED_SIMPLE_RH_Q16 3080				//0.047.
+#define DHT11_FIXED_SIMPLE_OFFSET_Q6 (-659)			//-10.3.
+#define DHT11_FIXED_C1_Q18 (-11109401L)				//-42.379.
+#define DHT11_FIXED_C2_Q26 137507084L				//2.04901523.
+#define DHT11_FIXED_C3_Q18 2659013L					//10.14333127.
+#define DHT11_FIXED_C4_Q26 (-15083080L)				//-0.22475541.
+#define DHT11_FIXED_C5_Q26 (-458879L)				//-0.00683783.
+#define DHT11_FIXED_C6_Q18 (-14370L)				//-0.05481717.
+#define DHT11_FIXED_C7_Q30 1319350L					//0.00122874.
+#define DHT11_FIXED_C8_Q26 57232L					//0.00085282.
+#define DHT11_FIXED_C9_Q32 (-8547L)					//-0.00000199.
+#define DHT11_FIXED_13_Q6 (13* 64)
+#define DHT11_FIXED_17_Q6 (17* 64)
+#define DHT11_FIXED_32_Q6 (32* 64)
+#define DHT11_FIXED_79_Q6 (79* 64)
+#define DHT11_FIXED_80_Q6 (80* 64)
+#define DHT11_FIXED_85_Q6 (85* 64)
+#define DHT11_FIXED_87_Q6 (87* 64)
+#define DHT11_FIXED_95_Q6 (95* 64)
+#define DHT11_FIXED_112_Q6 (112* 64)
+
+//Non-blocking measurements.
+#ifndef DHT11_MINIMUM_INTERVAL
+#define DHT11_MINIMUM_INTERVAL 1000		//Milliseconds between measurements. The sensor returns stale data if polled faster.
+#endif
+#define DHT11_STATE_IDLE 0
+#define DHT11_STATE_START_PULSE 1
+#define DHT11_STATE_CAPTURE 2
+
 //Status and error codes.
 #define DHT11_OK 0
 #define DHT11_ERROR 1
+#define DHT11_BUSY 2
+#define DHT11_IDLE 3
+#define DHT11_CACHED 4
 
 //Functions.
 //Request measurement from sensor. Must be called before other functions. 
@@ -71,6 +137,28 @@ void dht11_get_humidity_integer(uint8_t data[], uint8_t humidity[]);
 void dht11_get_temperature_integer(uint8_t unit, uint8_t data[], uint8_t temperature[]);
 //Return heat index as as a float.
 float dht11_get_heat_index(uint8_t unit, uint8_t data[]);
+//Return relative air humidity in tenths of a percent.
+int16_t dht11_get_humidity_fixed(uint8_t data[]);
+//Return ambient air temperature in tenths of a degree.
+int16_t dht11_get_temperature_fixed(uint8_t unit, uint8_t data[]);
+//Return heat index in tenths of a degree without floats.
+int16_t dht11_get_heat_index_fixed(uint8_t unit, uint8_t data[]);
+#ifdef DHT11_CAPTURE_ENABLE
+//Send the start signal and decode the response in the background.
+void dht11_capture_start(void);
+//Release the line and decode the response in the background. The start pulse must have been sent.
+void dht11_capture_arm(void);
+//Return the capture status. Copies the measurement when complete.
+uint8_t dht11_capture_status(uint8_t data[]);
+
+//Start a non-blocking measurement. Returns 'DHT11_BUSY' if one is running or the minimum interval hasn't passed.
+uint8_t dht11_start(void);
+//Advance a non-blocking measurement. Copies a new ('DHT11_OK') or the cached ('DHT11_CACHED') reading.
+uint8_t dht11_poll(uint8_t data[]);
+
+//External variables.
+extern volatile uint8_t dht11_capture_state;
+#endif
 
 /*
 Example implementation to read temperature as a float and integer.
@@ -100,6 +188,47 @@ main(){
 	}
 }
 
+Example implementation using interrupt driven capture (define 'DHT11_CAPTURE_ENABLE').
+
+main(){
+	
+	uint8_t data[DHT11_NUM_BYTES];
+	
+	while(1){
+		dht11_capture_start();
+		while(dht11_capture_status(data)== DHT11_BUSY){
+			//Do other stuff.
+		}
+		if(dht11_capture_status(data)== DHT11_OK){
+			float temperature= dht11_get_temperature(DHT11_CELCIUS, data);
+		}
+		delay(2000);
+	}
+}
+
+Example implementation using non-blocking measurements (define 'DHT11_CAPTURE_ENABLE').
+
+#include "timer.h"
+#include "dht11.h"
+
+main(){
+	
+	uint8_t data[DHT11_NUM_BYTES];
+	uint8_t status;
+	timer_set_millis();
+	
+	while(1){
+		dht11_start();		//Ignored until the minimum interval has passed.
+		status= dht11_poll(data);
+		if(status== DHT11_OK){
+			float temperature= dht11_get_temperature(DHT11_CELCIUS, data);	//New reading.
+		}else if(status== DHT11_CACHED){
+			//Last good reading. The latest measurement failed or hasn't finished.
+		}
+		//Do other stuff.
+	}
+}
+
 */
 
 #endif /* DHT11_H_ */
\ No newline at end of file
@@ -0,0 +1,144 @@
+/*
+ * dhtmulti.c
+ *
+ * Created: 19-Oct-26 1:40:52 PM
+ * Author : Ranul Deepanayake
+ */ 
+
+#include "dhtmulti.h"
+
+/*
+Convert the 5 received bytes of a sensor into a reading according to its framing.
+*/
+static void dht_multi_decode(uint8_t data[], uint8_t dht22, dht_multi_reading *reading){
+	uint8_t checksum= data[0]+ data[1]+ data[2]+ data[3];
+	
+	if(checksum!= data[DHT11_CHECKSUM_BYTE]){
+		reading->status= DHT11_ERROR;
+		return;
+	}
+	
+	if(dht22){
+		reading->humidity= ((uint16_t)data[0]<< 8) | data[1];
+		reading->temperature= ((uint16_t)(data[2] & 0x7F)<< 8) | data[3];
+		if(data[2] & 0x80){		//Sign bit.
+			reading->temperature= -reading->temperature;
+		}
+	}else{
+		reading->humidity= (data[DHT11_HUMIDITY_INT_BYTE]* 10)+ data[DHT11_HUMIDITY_DEC_BYTE];
+		reading->temperature= (data[DHT11_TEMPERATURE_INT_BYTE]* 10)+ data[DHT11_TEMPERATURE_DEC_BYTE];
+	}
+	reading->status= DHT11_OK;
+}
+
+/*
+Triggers every sensor in 'pins' at once and decodes all responses from the same port samples.
+'dht22_pins' selects DHT22 framing for a subset of 'pins'. Other pins use DHT11 framing.
+Fills 'readings' (indexed by pin number, size 'DHT_MULTI_MAX_SENSORS') and returns a mask of the pins that were read successfully.
+Blocks for one transaction time. Interrupts stay enabled. A falling edge seen late because of an ISR is moved back to
+'DHT_MULTI_LOW_TICKS' before the following rising edge, so ISRs up to about 40 microseconds don't change the bits.
+Uses Timer 2 while running. Returns 0 if another driver holds Timer 2.
+*/
+uint8_t dht_multi_measure(uint8_t pins, uint8_t dht22_pins, dht_multi_reading readings[]){
+	uint8_t data[DHT_MULTI_MAX_SENSORS][DHT11_NUM_BYTES];
+	uint8_t edges[DHT_MULTI_MAX_SENSORS];
+	uint8_t last_edge[DHT_MULTI_MAX_SENSORS];
+	uint8_t falling_edge[DHT_MULTI_MAX_SENSORS];	//Falling edge waiting for its rising edge.
+	uint8_t pending= pins, good= 0, overflows= 0, low= 0;
+	uint8_t previous= 0, current= 0, falling= 0, rising= 0, now= 0;
+	
+	for(uint8_t i= 0; i< DHT_MULTI_MAX_SENSORS; i++){
+		edges[i]= 0;
+		last_edge[i]= 0;
+		falling_edge[i]= 0;
+		for(uint8_t j= 0; j< DHT11_NUM_BYTES; j++){
+			data[i][j]= 0;
+		}
+	}
+	
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_2, TIMER_RESOURCE_BASE, TIMER_OWNER_DHT11, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){
+		return 0;
+	}
+	
+	//Send the start signal to every sensor.
+	DHT_MULTI_PORT_REGISTER|= pins;
+	DHT_MULTI_DDR_REGISTER|= pins;
+	DHT11_PIN_WAIT_MILLISECONDS(DHT11_STABILIZE_PULSE_TIME)
+	DHT_MULTI_PORT_REGISTER&= ~pins;
+	if(dht22_pins== pins){
+		DHT11_PIN_WAIT_MILLISECONDS(DHT_MULTI_DHT22_START_PULSE_TIME)
+	}else if(dht22_pins){
+		DHT11_PIN_WAIT_MILLISECONDS(DHT_MULTI_MIXED_START_PULSE_TIME)	//ISRs can only lengthen it.
+	}else{
+		DHT11_PIN_WAIT_MILLISECONDS(DHT11_START_PULSE_TIME)
+	}
+	
+	//Free running Timer 2 timestamps the edges.
+	TIMSK2= 0;
+	TCCR2A= 0;
+	TCNT2= 0;
+	TIFR2= DHT11_CAPTURE_TIMER_OVERFLOW_INTERRUPT;
+	TCCR2B= DHT11_CAPTURE_TIMER_PRESCALER;
+	
+	DHT_MULTI_PORT_REGISTER|= pins;
+	DHT_MULTI_DDR_REGISTER&= ~pins;	//Release the lines.
+	previous= pins;
+	
+	//Sample the whole port. A falling edge is timed once its rising edge is seen, then decoded as a bit.
+	while(pending){
+		current= DHT_MULTI_PIN_REGISTER;
+		now= TCNT2;
+		falling= previous & ~current & pending;
+		rising= ~previous & current & pending;
+		previous= current;
+		
+		if(falling | rising){
+			overflows= 0;
+			for(uint8_t i= 0; i< DHT_MULTI_MAX_SENSORS; i++){
+				if(falling & (1<< i)){
+					falling_edge[i]= now;
+				}
+				if(rising & (1<< i)){
+					low= now- falling_edge[i];
+					if(low< DHT_MULTI_LOW_TICKS){
+						falling_edge[i]= now- DHT_MULTI_LOW_TICKS;	//The falling edge was seen late.
+					}
+					uint8_t period= falling_edge[i]- last_edge[i];
+					last_edge[i]= falling_edge[i];
+					
+					if(edges[i]>= DHT11_CAPTURE_RESPONSE_EDGES){
+						uint8_t bit= edges[i]- DHT11_CAPTURE_RESPONSE_EDGES;
+						data[i][bit>> 3]= (data[i][bit>> 3]<< 1) | (period> DHT11_CAPTURE_BIT_THRESHOLD);
+					}
+					if(++edges[i]>= DHT11_CAPTURE_EDGES){
+						pending&= ~(1<< i);		//Sensor done.
+					}
+				}
+			}
+		}
+		
+		if(TIFR2 & DHT11_CAPTURE_TIMER_OVERFLOW_INTERRUPT){
+			TIFR2= DHT11_CAPTURE_TIMER_OVERFLOW_INTERRUPT;	//Cleared by writing a 1.
+			if(++overflows>= DHT_MULTI_TIMEOUT_OVERFLOWS){
+				break;	//Remaining sensors failed.
+			}
+		}
+	}
+	TCCR2B= 0;
+	timer_resource_release(TIMER_RESOURCE_TIMER_2, TIMER_OWNER_DHT11);
+	
+	for(uint8_t i= 0; i< DHT_MULTI_MAX_SENSORS; i++){
+		if(!(pins & (1<< i))){
+			continue;
+		}
+		if(pending & (1<< i)){
+			readings[i].status= DHT11_ERROR;
+			continue;
+		}
+		dht_multi_decode(data[i], dht22_pins & (1<< i), &readings[i]);
+		if(readings[i].status== DHT11_OK){
+			good|= (1<< i);
+		}
+	}
+	return good;
+}
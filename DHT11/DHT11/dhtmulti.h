@@ -0,0 +1,74 @@
+/*
+ * dhtmulti.h
+ *
+ * Created: 19-Oct-26 1:41:09 PM
+ * Author : Ranul Deepanayake
+ * Multi sensor DHT11/ DHT22 library for the ATmega 328P. Reads up to 8 sensors on the same GPIO port concurrently.
+ * All sensors are triggered at once and their bitstreams are decoded in parallel from port wide samples.
+ * A full sweep takes one transaction time (about 25 milliseconds) regardless of the number of sensors.
+ * Interrupts stay enabled. ISRs up to about 40 microseconds long don't disturb the bit timing. Longer ones can fail the checksum.
+ * Bits are classified from the time between falling edges, timed with Timer 2 (used only during a sweep).
+ * Supports DHT11 and DHT22 framing (16 bit values with a sign bit) per pin.
+ * Results are integers in tenths of a percent and tenths of a degree Celsius.
+ * Requires 'F_CPU', the DHT11 library and the timer resource manager of the Timer library.
+ */ 
+
+
+#ifndef DHTMULTI_H_
+#define DHTMULTI_H_
+
+//Library includes.
+#include "dht11.h"
+#include "timerresource.h"
+
+//Constant attributes and functions.
+#ifndef DHT_MULTI_DDR_REGISTER
+#define DHT_MULTI_DDR_REGISTER DDRD		//Default is PORTD.
+#endif
+#ifndef DHT_MULTI_PORT_REGISTER
+#define DHT_MULTI_PORT_REGISTER PORTD	//Default is PORTD.
+#endif
+#ifndef DHT_MULTI_PIN_REGISTER
+#define DHT_MULTI_PIN_REGISTER PIND		//Default is PIND.
+#endif
+#define DHT_MULTI_MAX_SENSORS 8			//One per port pin.
+#define DHT_MULTI_TIMEOUT_OVERFLOWS 24	//Timer 2 overflows (512 microseconds each) before unfinished sensors fail.
+#define DHT_MULTI_DHT22_START_PULSE_TIME 2	//Milliseconds. DHT22 only: at least 1ms, at most 20ms.
+#define DHT_MULTI_MIXED_START_PULSE_TIME 18	//Milliseconds. DHT11 needs at least 18ms. Leaves 2ms for ISRs before the DHT22 limit.
+#define DHT_MULTI_LOW_TICKS 24			//Timer 2 ticks. Shortest low phase before a bit (50 microseconds nominal).
+
+//Container for a reading.
+struct dht_multi_readings{
+	int16_t humidity;		//Tenths of a percent.
+	int16_t temperature;	//Tenths of a degree Celsius.
+	uint8_t status;			//'DHT11_OK' or 'DHT11_ERROR'.
+};
+
+typedef struct dht_multi_readings dht_multi_reading;
+
+//Functions.
+//Measure every sensor in 'pins' concurrently. Returns a mask of the pins that were read successfully.
+uint8_t dht_multi_measure(uint8_t pins, uint8_t dht22_pins, dht_multi_reading readings[]);
+
+/*
+Example implementation. DHT11 sensors on PD4 and PD5, DHT22 sensors on PD6 and PD7.
+
+#include "dhtmulti.h"
+
+main(){
+	
+	dht_multi_reading readings[DHT_MULTI_MAX_SENSORS];	//Indexed by pin number.
+	
+	while(1){
+		uint8_t good= dht_multi_measure(0xF0, 0xC0, readings);
+		if(good & (1<< 6)){
+			int16_t temperature= readings[6].temperature;	//235 is 23.5C.
+			//Do stuff.
+		}
+		delay(2000);
+	}
+}
+
+*/
+
+#endif /* DHTMULTI_H_ */
@@ -0,0 +1,359 @@
+/*
+ * inputcapture.c
+ *
+ * Created: 19-Oct-26 8:34:57 PM
+ * Author: Ranul Deepanayake
+ */ 
+
+#include "inputcapture.h"
+
+#define INPUT_CAPTURE_HAVE_RISING 0x01
+#define INPUT_CAPTURE_HAVE_FALLING 0x02
+
+volatile uint16_t input_capture_overflows= 0;		//Upper 16 bits of the Timer 1 count.
+volatile uint32_t input_capture_pulses= 0;			//Rising edges since 'input_capture_set'.
+uint32_t input_capture_frequency= 0;				//Last frequency (millihertz).
+uint8_t input_capture_mode= INPUT_CAPTURE_MODE_RECIPROCAL;			//Requested mode.
+uint8_t input_capture_active_mode= INPUT_CAPTURE_MODE_RECIPROCAL;	//Mode currently measuring.
+uint8_t input_capture_options= 0;					//Noise canceler bit of TCCR1B.
+
+//Reciprocal mode. Written by the capture ISR.
+volatile uint8_t input_capture_state= 0;			//'INPUT_CAPTURE_HAVE_RISING' and 'INPUT_CAPTURE_HAVE_FALLING'.
+volatile uint32_t input_capture_last_rising= 0;
+volatile uint32_t input_capture_last_falling= 0;
+volatile uint32_t input_capture_period= 0;			//CPU clock cycles.
+volatile uint32_t input_capture_high_time= 0;		//CPU clock cycles.
+volatile uint32_t input_capture_window_first= 0;	//First rising edge of the measurement window.
+volatile uint32_t input_capture_window_last= 0;		//Last rising edge of the measurement window.
+volatile uint8_t input_capture_window_edges= 0;		//Rising edges in the measurement window.
+volatile uint32_t input_capture_ring[INPUT_CAPTURE_RING_SIZE];	//Rising edge timestamps.
+volatile uint8_t input_capture_head= 0;				//Next slot to write.
+volatile uint8_t input_capture_unread= 0;			//Unread timestamps in the ring.
+
+//Gated mode.
+uint32_t input_capture_gate_count= 0;				//Edge count at the start of the gate.
+uint32_t input_capture_gate_start= 0;				//Microseconds at the start of the gate.
+
+/*
+Extend a Timer 1 count to 32 bits with the overflow count. Call with interrupts disabled.
+An overflow that hasn't been serviced yet is accounted for if the count was taken after it.
+*/
+static inline uint32_t input_capture_extend(uint16_t count){
+	uint16_t overflows= input_capture_overflows;
+	
+	if((TIFR1 & (1<< TOV1)) && count< 0x8000){
+		overflows++;
+	}
+	return ((uint32_t)overflows<< 16) | count;
+}
+
+/*
+Returns 'numerator'/ 'denominator' scaled by 10^'digits', one decimal digit at a time (no 64 bit math).
+'denominator' must be below 2^32/ 10.
+*/
+static uint32_t input_capture_ratio(uint32_t numerator, uint32_t denominator, uint8_t digits){
+	uint32_t quotient= numerator/ denominator;
+	uint32_t remainder= numerator% denominator;
+	
+	while(digits--){
+		remainder*= 10;
+		quotient= quotient* 10+ remainder/ denominator;
+		remainder%= denominator;
+	}
+	return quotient;
+}
+
+/*
+Timer 1 overflow interrupt. Extends the count to 32 bits.
+*/
+ISR(TIMER1_OVF_vect){
+	input_capture_overflows++;
+}
+
+/*
+Timer 1 input capture interrupt. Alternates between rising and falling edges.
+Rising edges give the period, the high time, a timestamp in the ring and the measurement window.
+The interrupt pauses when the window is full and the signal is too fast for edge by edge capture. 'input_capture_update' resumes it.
+*/
+ISR(TIMER1_CAPT_vect){
+	uint32_t timestamp= input_capture_extend(ICR1);
+	
+	if(!(TCCR1B & (1<< ICES1))){	//Falling edge.
+		TCCR1B|= (1<< ICES1);
+		TIFR1= (1<< ICF1);			//Changing the edge can set the flag.
+		input_capture_last_falling= timestamp;
+		input_capture_state|= INPUT_CAPTURE_HAVE_FALLING;
+		return;
+	}
+	
+	TCCR1B&= ~(1<< ICES1);
+	TIFR1= (1<< ICF1);
+	input_capture_pulses++;
+	if(input_capture_state & INPUT_CAPTURE_HAVE_RISING){
+		input_capture_period= timestamp- input_capture_last_rising;
+		if(input_capture_state & INPUT_CAPTURE_HAVE_FALLING){
+			input_capture_high_time= input_capture_last_falling- input_capture_last_rising;
+		}
+	}
+	input_capture_last_rising= timestamp;
+	input_capture_state= INPUT_CAPTURE_HAVE_RISING;
+	
+	input_capture_ring[input_capture_head]= timestamp;
+	input_capture_head= (input_capture_head+ 1) & INPUT_CAPTURE_RING_MASK;
+	if(input_capture_unread< INPUT_CAPTURE_RING_SIZE){
+		input_capture_unread++;	//Else the oldest timestamp has been overwritten.
+	}
+	
+	if(input_capture_window_edges== 0){
+		input_capture_window_first= timestamp;
+	}
+	if(input_capture_window_edges<= INPUT_CAPTURE_WINDOW_EDGES){
+		input_capture_window_last= timestamp;
+		if(++input_capture_window_edges> INPUT_CAPTURE_WINDOW_EDGES && 
+		timestamp- input_capture_window_first< (uint32_t)INPUT_CAPTURE_WINDOW_EDGES* INPUT_CAPTURE_OVERLOAD_TICKS){
+			TIMSK1&= ~(1<< ICIE1);	//Overloaded. Pause until the window is read.
+		}
+	}
+}
+
+/*
+Start measuring in reciprocal or gated mode. Timer 1 must be claimed.
+*/
+static void input_capture_start_mode(uint8_t mode){
+	cli();
+	TIMSK1= 0;
+	TCCR1A= 0;	//Normal mode.
+	input_capture_active_mode= mode;
+	
+	if(mode== INPUT_CAPTURE_MODE_RECIPROCAL){
+		TCCR1B= input_capture_options | (1<< ICES1) | INPUT_CAPTURE_PRESCALER;	//Rising edge first. The count keeps running.
+		TIFR1= (1<< ICF1);
+		input_capture_state= 0;
+		input_capture_window_edges= 0;
+		input_capture_head= 0;
+		input_capture_unread= 0;
+		input_capture_last_rising= input_capture_extend(TCNT1);	//Timeout reference.
+		TIMSK1= (1<< ICIE1) | (1<< TOIE1);
+		sei();
+		return;
+	}
+	
+	TCCR1B= INPUT_CAPTURE_EXTERNAL_CLOCK;
+	TIMSK1= (1<< TOIE1);
+	input_capture_gate_count= input_capture_extend(TCNT1);
+	sei();
+	input_capture_gate_start= timer_get_micros();
+}
+
+/*
+Claim Timer 1 and start measuring. 'mode' is 'INPUT_CAPTURE_MODE_RECIPROCAL' (ICP1 or the analog comparator), '_GATED' (T1) or '_AUTOMATIC' (both).
+'noise_canceler' is 'INPUT_CAPTURE_NOISE_CANCELER_ENABLE' or '_DISABLE' (reciprocal mode only).
+Reciprocal mode shares the free running Timer 1 base ('TIMER_RESOURCE_CONFIG_FREE_RUNNING_1'), the other modes need Timer 1 exclusively.
+Reciprocal mode is limited to about 50kHz. Use automatic mode if the signal can be faster.
+Any running measurement is stopped first. Returns 'INPUT_CAPTURE_ERROR' if Timer 1 is in use. 'timer_set_millis' must have been called for the gated and automatic modes.
+*/
+uint8_t input_capture_set(uint8_t mode, uint8_t noise_canceler){
+	uint8_t config= (mode== INPUT_CAPTURE_MODE_RECIPROCAL)? TIMER_RESOURCE_CONFIG_FREE_RUNNING_1: TIMER_RESOURCE_EXCLUSIVE;
+	
+	if(mode> INPUT_CAPTURE_MODE_AUTOMATIC){
+		return INPUT_CAPTURE_ERROR;
+	}
+	if(timer_resource_get_owner(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_CAPTURE)== TIMER_OWNER_CAPTURE){
+		input_capture_stop();	//The sharing configuration can change. Nothing keeps running if the claim below fails.
+	}
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_CAPTURE, TIMER_OWNER_CAPTURE, config)!= TIMER_RESOURCE_OK){
+		return INPUT_CAPTURE_ERROR;
+	}
+	
+	input_capture_mode= mode;
+	input_capture_options= noise_canceler & INPUT_CAPTURE_NOISE_CANCELER_ENABLE;
+	cli();
+	input_capture_pulses= 0;
+	input_capture_period= 0;
+	input_capture_high_time= 0;
+	sei();
+	input_capture_frequency= 0;
+	input_capture_start_mode((mode== INPUT_CAPTURE_MODE_GATED)? INPUT_CAPTURE_MODE_GATED: INPUT_CAPTURE_MODE_RECIPROCAL);
+	return INPUT_CAPTURE_OK;
+}
+
+/*
+Stop measuring and release Timer 1. The Timer 1 clock keeps running if another driver shares the base.
+*/
+void input_capture_stop(void){
+	TIMSK1= 0;
+	timer_resource_release(TIMER_RESOURCE_TIMER_1, TIMER_OWNER_CAPTURE);
+	if(timer_resource_get_owner(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE)== TIMER_OWNER_NONE){
+		TCCR1B= 0;
+	}else{
+		TCCR1B&= ~(INPUT_CAPTURE_NOISE_CANCELER_ENABLE | (1<< ICES1));
+	}
+}
+
+/*
+Finish a reciprocal measurement when the window is long enough, or a gated measurement when the gate time is over.
+Switches modes in automatic mode. Returns 'INPUT_CAPTURE_OK' when a new frequency is available, else 'INPUT_CAPTURE_BUSY'.
+Returns 'INPUT_CAPTURE_OVERLOAD' instead if the signal is too fast for reciprocal mode ('INPUT_CAPTURE_OVERLOAD_TICKS').
+The frequency reads 0 after 'INPUT_CAPTURE_TIMEOUT' ms without an edge.
+*/
+uint8_t input_capture_update(void){
+	uint32_t first, last, now, micros, count;
+	uint8_t edges, overloaded= 0;
+	
+	if(input_capture_active_mode== INPUT_CAPTURE_MODE_GATED){
+		if(timer_get_micros()- input_capture_gate_start< INPUT_CAPTURE_GATE_TIME){
+			return INPUT_CAPTURE_BUSY;
+		}
+		cli();
+		count= input_capture_extend(TCNT1);
+		sei();
+		micros= timer_get_micros();		//Same delay after the count as at the start of the gate.
+		
+		count-= input_capture_gate_count;
+		input_capture_frequency= input_capture_ratio(count, micros- input_capture_gate_start, 9);
+		input_capture_gate_count+= count;
+		input_capture_gate_start= micros;
+		cli();
+		input_capture_pulses+= count;
+		sei();
+		
+		if(input_capture_mode== INPUT_CAPTURE_MODE_AUTOMATIC && input_capture_frequency< INPUT_CAPTURE_RECIPROCAL_BELOW){
+			input_capture_start_mode(INPUT_CAPTURE_MODE_RECIPROCAL);
+		}
+		return INPUT_CAPTURE_OK;
+	}
+	
+	cli();
+	edges= input_capture_window_edges;
+	first= input_capture_window_first;
+	last= input_capture_window_last;
+	if(edges< 2 || (last- first< INPUT_CAPTURE_WINDOW_MIN_TICKS && edges<= INPUT_CAPTURE_WINDOW_EDGES)){
+		now= input_capture_extend(TCNT1);
+		if(now- input_capture_last_rising< INPUT_CAPTURE_TIMEOUT_TICKS){
+			sei();
+			return INPUT_CAPTURE_BUSY;
+		}
+		input_capture_state= 0;		//No edges. Start over.
+		input_capture_window_edges= 0;
+		input_capture_last_rising= now;
+		input_capture_period= 0;
+		input_capture_high_time= 0;
+		sei();
+		input_capture_frequency= 0;
+		return INPUT_CAPTURE_OK;
+	}
+	if(edges> INPUT_CAPTURE_WINDOW_EDGES){	//Full. Edges after it weren't counted, so the next window starts at the next rising edge.
+		input_capture_window_edges= 0;
+	}else{
+		input_capture_window_first= last;	//The next window starts at the last edge.
+		input_capture_window_edges= 1;
+	}
+	if(!(TIMSK1 & (1<< ICIE1))){		//Paused. Start over from the next rising edge.
+		overloaded= 1;
+		input_capture_state= 0;
+		TCCR1B|= (1<< ICES1);
+		TIFR1= (1<< ICF1);
+		TIMSK1|= (1<< ICIE1);
+	}
+	sei();
+	
+	input_capture_frequency= input_capture_ratio((uint32_t)(edges- 1)* F_CPU, last- first, 3);
+	
+	if(input_capture_mode== INPUT_CAPTURE_MODE_AUTOMATIC && input_capture_frequency> INPUT_CAPTURE_GATED_ABOVE){
+		input_capture_start_mode(INPUT_CAPTURE_MODE_GATED);
+	}else if(overloaded){
+		return INPUT_CAPTURE_OVERLOAD;
+	}
+	return INPUT_CAPTURE_OK;
+}
+
+/*
+Get the last frequency in millihertz (0.1Hz= 100). Updated by 'input_capture_update'.
+*/
+uint32_t input_capture_get_frequency(void){
+	return input_capture_frequency;
+}
+
+/*
+Get the last period in CPU clock cycles. Reciprocal mode only.
+*/
+uint32_t input_capture_get_period(void){
+	uint32_t temp;
+	cli();
+	temp= input_capture_period;
+	sei();
+	return temp;
+}
+
+/*
+Get the last high time in CPU clock cycles. Reciprocal mode only.
+*/
+uint32_t input_capture_get_high_time(void){
+	uint32_t temp;
+	cli();
+	temp= input_capture_high_time;
+	sei();
+	return temp;
+}
+
+/*
+Get the last duty cycle in hundredths of a percent (0- 10000). Reciprocal mode only.
+The high time and the period can be from consecutive cycles.
+*/
+uint16_t input_capture_get_duty_cycle(void){
+	uint32_t period, high_time;
+	
+	cli();
+	period= input_capture_period;
+	high_time= input_capture_high_time;
+	sei();
+	if(period== 0 || high_time> period){
+		return 0;
+	}
+	return input_capture_ratio(high_time, period, 4);
+}
+
+/*
+Get the number of rising edges since 'input_capture_set'.
+Edges while the capture interrupt is paused (reciprocal mode above 50kHz) aren't counted.
+*/
+uint32_t input_capture_get_pulses(void){
+	uint32_t temp;
+	cli();
+	temp= input_capture_pulses;
+	if(input_capture_active_mode== INPUT_CAPTURE_MODE_GATED){
+		temp+= input_capture_extend(TCNT1)- input_capture_gate_count;	//The running gate.
+	}
+	sei();
+	return temp;
+}
+
+/*
+Get the mode currently measuring ('INPUT_CAPTURE_MODE_RECIPROCAL' or '_GATED').
+*/
+uint8_t input_capture_get_mode(void){
+	return input_capture_active_mode;
+}
+
+/*
+Returns the number of unread rising edge timestamps.
+*/
+uint8_t input_capture_available(void){
+	return input_capture_unread;
+}
+
+/*
+Pops the oldest unread rising edge timestamp (CPU clock cycles, wraps after 2^32).
+The ring is cleared when reciprocal mode (re)starts. Returns 'INPUT_CAPTURE_ERROR' if there are no unread timestamps.
+*/
+uint8_t input_capture_read_timestamp(uint32_t *timestamp){
+	cli();
+	if(input_capture_unread== 0){
+		sei();
+		return INPUT_CAPTURE_ERROR;
+	}
+	*timestamp= input_capture_ring[(input_capture_head- input_capture_unread) & INPUT_CAPTURE_RING_MASK];
+	input_capture_unread--;
+	sei();
+	return INPUT_CAPTURE_OK;
+}
@@ -0,0 +1,131 @@
+/*
+ * inputcapture.h
+ *
+ * Created: 19-Oct-26 8:35:14 PM
+ * Author: Ranul Deepanayake
+ * Frequency, period and duty cycle measurement with Timer 1 for the ATmega328P (0.1Hz- 1MHz in gated and automatic modes).
+ * Reciprocal mode: the input capture unit (ICP1, PB0, or the analog comparator) timestamps every edge at the CPU clock.
+ * Timestamps are extended to 32 bits with the Timer 1 overflows. Rising edge timestamps are kept in a ring.
+ * Frequency is measured over whole periods (up to 'INPUT_CAPTURE_WINDOW_EDGES' per window), so the resolution doesn't depend on the frequency.
+ * Every edge takes an interrupt, so reciprocal mode only follows signals up to about 50kHz ('INPUT_CAPTURE_OVERLOAD_TICKS'). Faster signals lose edges and read low.
+ * Gated mode: Timer 1 counts the edges on T1 (PD5). Frequency is the count over a gate time of about 'INPUT_CAPTURE_GATE_TIME' microseconds.
+ * Automatic mode switches between the two (the signal must be connected to both PB0 and PD5).
+ * Call 'input_capture_update' regularly from the main loop. Nothing blocks.
+ * Frequencies are in millihertz, periods and high times in CPU clock cycles, duty cycles in hundredths of a percent.
+ * Claims Timer 1 through the timer resource manager. Requires the Timer library (the gate time uses 'timer_get_micros').
+ */ 
+
+
+#ifndef INPUTCAPTURE_H_
+#define INPUTCAPTURE_H_
+
+//Includes.
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "timer.h"
+
+//Attributes.
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define INPUT_CAPTURE_MODE_RECIPROCAL 0
+#define INPUT_CAPTURE_MODE_GATED 1
+#define INPUT_CAPTURE_MODE_AUTOMATIC 2
+#define INPUT_CAPTURE_NOISE_CANCELER_DISABLE 0x00
+#define INPUT_CAPTURE_NOISE_CANCELER_ENABLE 0x80		//ICNC1. Four sample filter, delays the capture by 4 cycles.
+
+#ifndef INPUT_CAPTURE_RING_SIZE
+#define INPUT_CAPTURE_RING_SIZE 16						//Must be a power of two.
+#endif
+#define INPUT_CAPTURE_RING_MASK (INPUT_CAPTURE_RING_SIZE- 1)
+#define INPUT_CAPTURE_WINDOW_EDGES 64					//Most periods per reciprocal measurement. Keeps the ISR load bounded.
+#define INPUT_CAPTURE_WINDOW_MIN_TICKS (F_CPU/ 100)		//A reciprocal measurement spans at least 10ms (or 'INPUT_CAPTURE_WINDOW_EDGES').
+#define INPUT_CAPTURE_OVERLOAD_TICKS (F_CPU/ 50000UL)	//Average period (CPU clock cycles) below which the capture interrupt pauses between measurements (50kHz).
+#ifndef INPUT_CAPTURE_GATE_TIME
+#define INPUT_CAPTURE_GATE_TIME 100000UL				//Gate time (microseconds). 10mHz resolution per second of gate time.
+#endif
+#ifndef INPUT_CAPTURE_TIMEOUT
+#define INPUT_CAPTURE_TIMEOUT 20000UL					//Milliseconds without an edge before the frequency reads 0. At most 26s at 16MHz.
+#endif
+#define INPUT_CAPTURE_TIMEOUT_TICKS ((F_CPU/ 1000)* INPUT_CAPTURE_TIMEOUT)
+#define INPUT_CAPTURE_GATED_ABOVE 20000000UL			//Automatic mode switches to gated counting above 20kHz (millihertz).
+#define INPUT_CAPTURE_RECIPROCAL_BELOW 10000000UL		//And back to reciprocal counting below 10kHz.
+#define INPUT_CAPTURE_PRESCALER 0x01					//Timer 1 at the CPU clock.
+#define INPUT_CAPTURE_EXTERNAL_CLOCK 0x07				//Timer 1 clocked by rising edges on T1.
+
+//Status and error codes.
+#define INPUT_CAPTURE_OK 0
+#define INPUT_CAPTURE_ERROR 1
+#define INPUT_CAPTURE_BUSY 2
+#define INPUT_CAPTURE_OVERLOAD 3	//Reciprocal mode at or above its limit. The frequency is unreliable.
+
+//Functions.
+//Claim Timer 1 and start measuring.
+uint8_t input_capture_set(uint8_t mode, uint8_t noise_canceler);
+//Stop measuring and release Timer 1.
+void input_capture_stop(void);
+//Finish measurements. Call regularly.
+uint8_t input_capture_update(void);
+//Get the last frequency (millihertz).
+uint32_t input_capture_get_frequency(void);
+//Get the last period (CPU clock cycles). Reciprocal mode only.
+uint32_t input_capture_get_period(void);
+//Get the last high time (CPU clock cycles). Reciprocal mode only.
+uint32_t input_capture_get_high_time(void);
+//Get the last duty cycle (hundredths of a percent). Reciprocal mode only.
+uint16_t input_capture_get_duty_cycle(void);
+//Get the number of rising edges since the start.
+uint32_t input_capture_get_pulses(void);
+//Get the mode currently measuring.
+uint8_t input_capture_get_mode(void);
+//Returns the number of unread timestamps.
+uint8_t input_capture_available(void);
+//Pops the oldest unread rising edge timestamp.
+uint8_t input_capture_read_timestamp(uint32_t *timestamp);
+
+//External variables.
+extern volatile uint16_t input_capture_overflows;
+extern volatile uint32_t input_capture_pulses;
+extern uint32_t input_capture_frequency;
+
+/*
+Example implementation. Tachometer on PB0 and PD5, 0.1Hz- 1MHz.
+
+#include "timer.h"
+#include "inputcapture.h"
+
+int main(void)
+{
+	uint32_t rpm;
+	
+	timer_set_millis();
+	input_capture_set(INPUT_CAPTURE_MODE_AUTOMATIC, INPUT_CAPTURE_NOISE_CANCELER_ENABLE);
+	
+	while (1)
+	{
+		if(input_capture_update()== INPUT_CAPTURE_OK){
+			rpm= input_capture_get_frequency()* 60/ 1000;	//One pulse per revolution.
+		}
+		//Do stuff.
+	}
+}
+
+Example implementation. Flow meter pulses with timestamps through the analog comparator (AIN0 vs AIN1).
+
+	timer_set_millis();
+	analog_comparator_set(ANALOG_COMPARATOR_POSITIVE_AIN0, ANALOG_COMPARATOR_NEGATIVE_AIN1, ANALOG_COMPARATOR_INTERRUPT_DISABLE, ANALOG_COMPARATOR_CAPTURE_ENABLE);
+	input_capture_set(INPUT_CAPTURE_MODE_RECIPROCAL, INPUT_CAPTURE_NOISE_CANCELER_DISABLE);
+	
+	while (1)
+	{
+		input_capture_update();
+		while(input_capture_read_timestamp(&timestamp)== INPUT_CAPTURE_OK){
+			//Log the pulse.
+		}
+		volume= input_capture_get_pulses()/ PULSES_PER_LITRE;
+	}
+
+*/
+
+#endif /* INPUTCAPTURE_H_ */
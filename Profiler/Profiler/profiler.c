@@ -0,0 +1,122 @@
+/*
+ * profiler.c
+ *
+ * Created: 19-Oct-26 9:52:19 PM
+ * Author: Ranul Deepanayake
+ */ 
+
+#include "profiler.h"
+
+#ifdef PROFILER_ENABLE
+volatile uint16_t profiler_start[PROFILER_MAX_SECTIONS];	//Timer 1 count at 'PROFILE_BEGIN'.
+profiler_section profiler_table[PROFILER_MAX_SECTIONS];		//Statistics of every section.
+uint16_t profiler_overhead= 0;								//Ticks of an empty section.
+volatile uint16_t profiler_calibration_start;				//Stands in for 'profiler_start' while measuring the overhead.
+
+/*
+Claim Timer 1 and start it free running at 'PROFILER_PRESCALER'. The count isn't reset, so a sharing driver isn't disturbed.
+Measures the ticks of an empty section and clears the table.
+Returns 'PROFILER_ERROR' if another driver holds Timer 1 with a different setup.
+*/
+uint8_t profiler_set(void){
+	uint8_t config= (PROFILER_PRESCALER== 0x01)? TIMER_RESOURCE_CONFIG_FREE_RUNNING_1: TIMER_RESOURCE_EXCLUSIVE;
+	
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE, TIMER_OWNER_PROFILER, config)!= TIMER_RESOURCE_OK){
+		return PROFILER_ERROR;
+	}
+	cli();		//The Input Capture ISR changes TCCR1B too.
+	TCCR1A= 0;	//Normal mode.
+	TCCR1B= (TCCR1B & ~PROFILER_PRESCALER_BITS) | PROFILER_PRESCALER;
+	sei();
+	
+	profiler_overhead= 0;
+	for(uint8_t i= 0; i< 4; i++){	//Keep the smallest. An interrupt can stretch a run.
+		uint16_t elapsed;
+		
+		profiler_calibration_start= profiler_now();
+		elapsed= profiler_now()- profiler_calibration_start;
+		if(i== 0 || elapsed< profiler_overhead){
+			profiler_overhead= elapsed;
+		}
+	}
+	profiler_clear();
+	return PROFILER_OK;
+}
+
+/*
+Add a section time to the table. Called by 'PROFILE_END' with the Timer 1 count at the end of the section.
+*/
+void profiler_end(uint8_t id, uint16_t now){
+	profiler_section *section;
+	uint16_t elapsed;
+	uint8_t sreg;
+	
+	if(id>= PROFILER_MAX_SECTIONS){
+		return;
+	}
+	section= &profiler_table[id];
+	elapsed= now- profiler_start[id];
+	elapsed= (elapsed> profiler_overhead)? elapsed- profiler_overhead: 0;
+	
+	sreg= SREG;		//Sections can end in ISRs.
+	cli();
+	if(section->count== 0 || elapsed< section->min){
+		section->min= elapsed;
+	}
+	if(elapsed> section->max){
+		section->max= elapsed;
+	}
+	if(section->count== PROFILER_COUNT_MAX){
+		section->sum>>= 1;
+		section->count>>= 1;
+	}
+	section->sum+= elapsed;
+	section->count++;
+	SREG= sreg;
+}
+
+/*
+Copy the statistics of a section. Returns 'PROFILER_ERROR' if the section hasn't run yet.
+*/
+uint8_t profiler_get(uint8_t id, profiler_section *section){
+	if(id>= PROFILER_MAX_SECTIONS){
+		return PROFILER_ERROR;
+	}
+	cli();
+	*section= profiler_table[id];
+	sei();
+	return (section->count== 0)? PROFILER_ERROR: PROFILER_OK;
+}
+
+/*
+Clear the table.
+*/
+void profiler_clear(void){
+	cli();
+	for(uint8_t i= 0; i< PROFILER_MAX_SECTIONS; i++){
+		profiler_table[i].min= 0;
+		profiler_table[i].max= 0;
+		profiler_table[i].sum= 0;
+		profiler_table[i].count= 0;
+	}
+	sei();
+}
+
+/*
+Print the table over UART. One line per section that has run: id, minimum, maximum, average and count.
+Times are in timer ticks ('PROFILER_PRESCALER' CPU clock cycles). 'uart_set' must have been called.
+*/
+void profiler_dump(void){
+	profiler_section section;
+	char temp[48];
+	
+	uart_println("Section\tMin\tMax\tAvg\tCount");
+	for(uint8_t i= 0; i< PROFILER_MAX_SECTIONS; i++){
+		if(profiler_get(i, &section)!= PROFILER_OK){
+			continue;
+		}
+		sprintf(temp, "%u\t%u\t%u\t%lu\t%u", i, section.min, section.max, (unsigned long)(section.sum/ section.count), section.count);
+		uart_println(temp);
+	}
+}
+#endif
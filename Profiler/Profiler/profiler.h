@@ -0,0 +1,141 @@
+/*
+ * profiler.h
+ *
+ * Created: 19-Oct-26 9:52:36 PM
+ * Author: Ranul Deepanayake
+ * Code section profiler for the ATmega328P. Times sections with free running Timer 1 at the CPU clock.
+ * Wrap a section in 'PROFILE_BEGIN(id)' and 'PROFILE_END(id)'. Works in ISRs and with nested sections (different ids).
+ * The minimum, maximum, average and count of every section are kept in a table and can be dumped over UART.
+ * The cost of the macros themselves is measured once and subtracted.
+ * Sections must be shorter than 65536 timer ticks (4ms at 16MHz with prescaler 1). Use a larger 'PROFILER_PRESCALER' for longer sections.
+ * Compiled out completely (no code, no RAM) unless 'PROFILER_ENABLE' is defined.
+ * Claims Timer 1 through the timer resource manager. Prescaler 1 shares the base with the Input Capture library (reciprocal mode).
+ * Requires the UART library and the Timer library (timer resource manager).
+ */ 
+
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+//Includes.
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "uart.h"
+#include "timerresource.h"
+
+//Defines.
+//#define PROFILER_ENABLE			//Uncomment (or define in the compiler flags) to compile the profiler in.
+#ifndef PROFILER_MAX_SECTIONS
+#define PROFILER_MAX_SECTIONS 8		//Change according to the number of sections.
+#endif
+#ifndef PROFILER_PRESCALER
+#define PROFILER_PRESCALER 0x01		//Timer 1 prescaler 1 (cycle accurate). 0x02: 8 (32ms at 16MHz), 0x03: 64 (262ms at 16MHz). Only 1 can be shared.
+#endif
+#define PROFILER_PRESCALER_BITS 0x07
+#define PROFILER_COUNT_MAX 0xFFFF		//The sum and the count are halved here, so the average keeps following the section.
+
+//Status and error codes.
+#define PROFILER_OK 0
+#define PROFILER_ERROR 1
+
+//Container for the statistics of a section. Times in timer ticks ('PROFILER_PRESCALER' CPU clock cycles).
+struct profiler_sections{
+	uint16_t min;
+	uint16_t max;
+	uint32_t sum;
+	uint16_t count;
+};
+
+typedef struct profiler_sections profiler_section;
+
+#ifdef PROFILER_ENABLE
+//Start timing a section.
+#define PROFILE_BEGIN(id) profiler_start[(id)]= profiler_now();
+//Stop timing a section and add it to the table.
+#define PROFILE_END(id) profiler_end((id), profiler_now());
+
+/*
+Read Timer 1 atomically. The 16 bit read shares the TEMP register with ISRs, so interrupts are held off for it.
+*/
+static inline uint16_t profiler_now(void){
+	uint16_t count;
+	uint8_t sreg= SREG;
+	cli();
+	count= TCNT1;
+	SREG= sreg;
+	return count;
+}
+
+//Functions.
+//Claim Timer 1, start it and measure the profiler overhead.
+uint8_t profiler_set(void);
+//Add a section time to the table. Called by 'PROFILE_END'.
+void profiler_end(uint8_t id, uint16_t now);
+//Copy the statistics of a section.
+uint8_t profiler_get(uint8_t id, profiler_section *section);
+//Clear the table.
+void profiler_clear(void);
+//Print the table over UART.
+void profiler_dump(void);
+
+//External variables.
+extern volatile uint16_t profiler_start[PROFILER_MAX_SECTIONS];
+extern profiler_section profiler_table[PROFILER_MAX_SECTIONS];
+extern uint16_t profiler_overhead;
+#else
+#define PROFILE_BEGIN(id)
+#define PROFILE_END(id)
+#define profiler_set() PROFILER_OK
+#define profiler_get(id, section) PROFILER_ERROR
+#define profiler_clear()
+#define profiler_dump()
+#endif
+
+/*
+Example implementation. Build with -DPROFILER_ENABLE (and -DPROFILER_PRESCALER=0x02 for sections longer than 4ms such as 'dht11_measure').
+
+#include "uart.h"
+#include "i2c.h"
+#include "bmp280.h"
+#include "profiler.h"
+
+#define PROFILE_PRESSURE 0
+#define PROFILE_UART_RX 1	//Section 1 is timed inside the existing RX ISR of uart.c (see below).
+
+int main(void)
+{
+	bmp280_coefficient_container coefficients;
+	uint32_t pressure;
+	
+	uart_set(UART_BAUD_RATE(9600), 8, UART_PARITY_NONE, UART_STOP_BITS_1);
+	i2c_set(I2C_BAUD_RATE(I2C_SCL_CLOCK));
+	bmp280_set(BMP280_MODE_NORMAL, BMP280_OVERSAMPLE_PRESSURE_X4, BMP280_OVERSAMPLE_TEMPERATURE_X1, BMP280_FILTER_OFF, BMP280_STANDBY_0_5_MS);
+	bmp280_get_coefficient_data(&coefficients);
+	profiler_set();
+	
+	for(uint16_t i= 0; i< 1000; i++){
+		PROFILE_BEGIN(PROFILE_PRESSURE)
+		pressure= bmp280_get_pressure_integer(&coefficients);
+		PROFILE_END(PROFILE_PRESSURE)
+	}
+	profiler_dump();
+	
+	while (1)
+	{
+		
+	}
+}
+
+ISRs are profiled where they are defined. uart.c already defines 'USART_RX_vect', so add the section there
+(and '#include "profiler.h"' at the top of uart.c) instead of defining the vector again:
+
+ISR(USART_RX_vect){	
+	PROFILE_BEGIN(1)	//'PROFILE_UART_RX'.
+	uart_rx_buffer_push(&rx_buffer, UDR0);
+	PROFILE_END(1)
+}
+
+*/
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,42 @@
+/*
+ * spi.c
+ *
+ * Created: 19-Oct-26 11:02:21 AM
+ * Author: Ranul Deepanayake
+ */ 
+
+#include "spi.h"
+
+/*
+Set up the SPI peripheral as a master.
+Use the 'SPI_MODE_x', 'SPI_MSB_FIRST'/ 'SPI_LSB_FIRST' and 'SPI_CLOCK_DIV_x' macros.
+*/
+void spi_set(uint8_t mode, uint8_t bit_order, uint8_t clock_divider){
+	SPI_DDR_REGISTER|= (SPI_SS_PIN | SPI_MOSI_PIN | SPI_SCK_PIN);	//SS must be an output or a low level on it drops the peripheral out of master mode.
+	SPI_DDR_REGISTER&= ~SPI_MISO_PIN;
+	SPCR= ((1<< SPE) | (1<< MSTR) | bit_order | mode | (clock_divider & SPI_CLOCK_RATE_BITS));	//Enable SPI in master mode.
+	
+	if(clock_divider & SPI_CLOCK_DOUBLE_SPEED){
+		SPSR|= (1<< SPI2X);
+	}else{
+		SPSR&= ~(1<< SPI2X);
+	}
+}
+
+/*
+Send one byte and return the byte shifted in from the slave at the same time.
+*/
+uint8_t spi_transfer(uint8_t data){
+	SPDR= data;
+	while(!(SPSR & (1<< SPIF)));	//Wait for the transfer to complete.
+	return SPDR;
+}
+
+/*
+Read a block of bytes by sending dummy bytes.
+*/
+void spi_read_block(uint8_t *data, uint8_t length){
+	for(uint8_t i= 0; i< length; i++){
+		data[i]= spi_transfer(SPI_DUMMY_BYTE);
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ * spi.h
+ *
+ * Created: 19-Oct-26 11:02:37 AM
+ * Author: Ranul Deepanayake
+ * Hardware SPI library for the ATmega328P. Supports master mode only.
+ * Slave select pins are handled by the device libraries. SS (PB2) is made an output so that the peripheral stays in master mode.
+ */ 
+
+#ifndef SPI_H_
+#define SPI_H_
+
+//Includes.
+#include <avr/io.h>	//Pin definitions.
+
+//Attributes.
+#define SPI_DDR_REGISTER DDRB
+#define SPI_SS_PIN 0x04
+#define SPI_MOSI_PIN 0x08
+#define SPI_MISO_PIN 0x10
+#define SPI_SCK_PIN 0x20
+
+#define SPI_MODE_0 0x00		//CPOL= 0, CPHA= 0.
+#define SPI_MODE_1 0x04		//CPOL= 0, CPHA= 1.
+#define SPI_MODE_2 0x08		//CPOL= 1, CPHA= 0.
+#define SPI_MODE_3 0x0C		//CPOL= 1, CPHA= 1.
+
+#define SPI_MSB_FIRST 0x00
+#define SPI_LSB_FIRST 0x20
+
+//Clock divider. Bit 2 selects double speed (SPI2X).
+#define SPI_CLOCK_DIV_2 0x04	//8MHz at 16MHz.
+#define SPI_CLOCK_DIV_4 0x00
+#define SPI_CLOCK_DIV_8 0x05
+#define SPI_CLOCK_DIV_16 0x01
+#define SPI_CLOCK_DIV_32 0x06
+#define SPI_CLOCK_DIV_64 0x02
+#define SPI_CLOCK_DIV_128 0x03
+#define SPI_CLOCK_RATE_BITS 0x03
+#define SPI_CLOCK_DOUBLE_SPEED 0x04
+
+#define SPI_DUMMY_BYTE 0xFF
+
+//Functions.
+//Set up the SPI peripheral as a master.
+void spi_set(uint8_t mode, uint8_t bit_order, uint8_t clock_divider);
+//Send a byte and return the byte received at the same time.
+uint8_t spi_transfer(uint8_t data);
+//Read a block of bytes (sends dummy bytes).
+void spi_read_block(uint8_t *data, uint8_t length);
+
+/*
+Example implementation. Read two bytes from an SPI slave with the slave select on PB1.
+
+#include "spi.h"
+
+void main(){
+	DDRB|= 0x02;
+	PORTB|= 0x02;
+	spi_set(SPI_MODE_0, SPI_MSB_FIRST, SPI_CLOCK_DIV_4);
+	
+	while(1){
+		uint8_t data[2];
+		PORTB&= ~0x02;
+		spi_transfer(COMMAND_BYTE);
+		spi_read_block(data, 2);
+		PORTB|= 0x02;
+	}
+}
+
+*/
+
+#endif /* SPI_H_ */
@@ -13,8 +13,15 @@ Timer 1 and output compare A/B are used. Can control only two servos.
 Servo 1-> OCR1A, servo 2-> OCR1B. 
 Servos are controlled with a 50Hz phase correct 1mS- 2mS duty cycle square wave.
 Initializes servo to 90 degrees.
+Returns 'SERVO_ERROR' if another driver holds the Timer 1 base or the output compare unit.
 */
-void servo_set(uint8_t servo_number){
+uint8_t servo_set(uint8_t servo_number){
+	uint8_t compare= (servo_number== SERVO_1)? TIMER_RESOURCE_COMPARE_B: TIMER_RESOURCE_COMPARE_A;
+	
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE | compare, TIMER_OWNER_SERVO, TIMER_RESOURCE_CONFIG_SERVO_50HZ)!= TIMER_RESOURCE_OK){
+		return SERVO_ERROR;
+	}
+	
 	SERVO_WAVEFORM_MODE_10	//Set waveform generation mode to phase correct PWM (mode 10).
 	SERVO_TCCRB_REGISTER|= SERVO_TIMER_PRESCALER;	//Set prescaler to 8.
 	SERVO_ICR_REGISTER= SERVO_ICR_VALUE;	//TOP (gives 49.90 Hz). Sets frequency.
@@ -36,6 +43,19 @@ void servo_set(uint8_t servo_number){
 		servo_write(SERVO_0, 90);
 		break;
 	}
+	return SERVO_OK;
+}
+
+/*
+Disconnect both servo outputs and release Timer 1. The timer is stopped unless another driver shares the base.
+*/
+void servo_stop(){
+	SERVO_TCCRA_REGISTER&= ~(SERVO_0_COM_MODE | SERVO_1_COM_MODE);
+	timer_resource_release(TIMER_RESOURCE_TIMER_1, TIMER_OWNER_SERVO);
+	if(timer_resource_get_owner(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE)== TIMER_OWNER_NONE){
+		SERVO_TCCRB_REGISTER= 0;
+		SERVO_TCCRA_REGISTER= 0;
+	}
 }
 
 /*
@@ -10,6 +10,7 @@
  * Initializes servo to 90 degrees.
  * OCR values tested-> Min- 500 (87.5 mV, 2.5%), Max- 3000 (502 mV, 15%).
  * Minimum and maximum OCR values may have to be changed depending on the servo. 
+ * Timer 1 is claimed through the timer resource manager. The base can be shared with 'TIMER_RESOURCE_CONFIG_SERVO_50HZ' (e.g. PWM on the unused channel).
  */ 
 
 
@@ -19,6 +20,7 @@
 //Includes.
 #include <avr/io.h>
 #include <util/delay.h>
+#include "timerresource.h"
 
 //Defines.
 #define SERVO_DDR_REGISTER DDRB
@@ -45,9 +47,15 @@
 #define SERVO_MAX_OCR 3000 //2600. Change accordingly.
 #define SERVO_ICR_VALUE 20000 //Gives 50Hz.
 
+//Status and error codes.
+#define SERVO_OK 0
+#define SERVO_ERROR 1
+
 //Functions.
 //Set up the servo motor. Servo 1-> OCR1A, servo 2-> OCR1B. 
-void servo_set(uint8_t servo_number);
+uint8_t servo_set(uint8_t servo_number);
+//Stop both servo outputs and release Timer 1.
+void servo_stop();
 //Actuate the specified servo according to the specified angular position (0- 180 degrees).
 void servo_write(uint8_t servo_number, uint8_t angle);
 //Sweeps connected and initialized servos 180 degrees and back.
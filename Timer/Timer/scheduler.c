@@ -0,0 +1,162 @@
+/*
+ * scheduler.c
+ *
+ * Created: 19-Oct-26 5:02:31 PM
+ * Author: Ranul Deepanayake
+ */ 
+
+#include "scheduler.h"
+
+scheduler_task scheduler_table[SCHEDULER_MAX_TASKS];	//Task table.
+uint32_t scheduler_next_release= 0;		//Earliest release in the table.
+uint8_t scheduler_task_count= 0;		//Tasks in the table.
+
+/*
+Find the earliest release in the table relative to 'now'.
+*/
+static void scheduler_update_next_release(uint32_t now){
+	uint32_t earliest= 0xFFFFFFFF;
+	
+	for(uint8_t i= 0; i< SCHEDULER_MAX_TASKS; i++){
+		if(scheduler_table[i].function){
+			int32_t wait= scheduler_table[i].release- now;	//Signed difference. Correct across the wrap around.
+			uint32_t remaining= (wait< 0)? 0: wait;
+			if(remaining< earliest){
+				earliest= remaining;
+			}
+		}
+	}
+	scheduler_next_release= now+ earliest;
+}
+
+/*
+Add a task. It is first released 'delay' ms from now, then every 'period' ms ('SCHEDULER_ONE_SHOT' runs it once).
+'deadline' is the time (ms) after a release within which the task has to finish. 'SCHEDULER_NO_DEADLINE' uses the period.
+Returns the task id or 'SCHEDULER_ERROR' if the table is full.
+*/
+uint8_t scheduler_add(void (*function)(void), uint32_t delay, uint32_t period, uint32_t deadline){
+	uint32_t now= timer_get_millis();
+	
+	if(function== 0){
+		return SCHEDULER_ERROR;
+	}
+	for(uint8_t i= 0; i< SCHEDULER_MAX_TASKS; i++){
+		if(scheduler_table[i].function== 0){
+			scheduler_table[i].function= function;
+			scheduler_table[i].period= period;
+			scheduler_table[i].release= now+ delay;
+			scheduler_table[i].deadline= (deadline== SCHEDULER_NO_DEADLINE)? period: deadline;
+			scheduler_clear_statistics(i);
+			
+			if(scheduler_task_count== 0 || (int32_t)(scheduler_table[i].release- scheduler_next_release)< 0){
+				scheduler_next_release= scheduler_table[i].release;
+			}
+			scheduler_task_count++;
+			return i;
+		}
+	}
+	return SCHEDULER_ERROR;
+}
+
+/*
+Remove a task. Can be called from a task, including the task itself.
+*/
+void scheduler_remove(uint8_t id){
+	if(id>= SCHEDULER_MAX_TASKS || scheduler_table[id].function== 0){
+		return;
+	}
+	scheduler_table[id].function= 0;
+	scheduler_task_count--;		//The cached release may now be early. That only costs one empty pass.
+}
+
+/*
+Run the tasks that are due, in table order. Call as often as possible from the main loop.
+Returns immediately (constant time) if nothing is due. Returns the number of tasks run.
+*/
+uint8_t scheduler_run(void){
+	uint32_t now= timer_get_millis();
+	uint8_t count= 0;
+	
+	if(scheduler_task_count== 0 || (int32_t)(now- scheduler_next_release)< 0){
+		return 0;
+	}
+	
+	for(uint8_t i= 0; i< SCHEDULER_MAX_TASKS; i++){
+		scheduler_task *task= &scheduler_table[i];
+		uint32_t release= task->release;
+		uint32_t lateness= 0;
+		void (*function)(void)= task->function;
+		
+		if(function== 0 || (int32_t)(now- release)< 0){
+			continue;
+		}
+		
+		lateness= now- release;
+		if(lateness> task->max_lateness){
+			task->max_lateness= (lateness> 0xFFFF)? 0xFFFF: lateness;
+		}
+		if(task->period== SCHEDULER_ONE_SHOT){
+			scheduler_remove(i);	//Removed before running so it can add itself again.
+		}else{
+			task->release= release+ task->period;
+			if((int32_t)(now- task->release)>= 0){	//A whole period behind. Drop the missed releases instead of bursting.
+				task->skipped+= (now- release)/ task->period;
+				task->release= release+ ((now- release)/ task->period+ 1)* task->period;
+			}
+		}
+		
+		function();
+		count++;
+		now= timer_get_millis();
+		
+		if(task->function== function){	//Not removed or replaced by the task itself.
+			if(task->deadline && now- release> task->deadline && task->misses< 0xFFFF){
+				task->misses++;
+			}
+			if(task->runs< 0xFFFF){
+				task->runs++;
+			}
+		}
+	}
+	
+	scheduler_update_next_release(now);
+	return count;
+}
+
+/*
+Return the time until the next release in ms (0 if a task is due). Returns 0xFFFFFFFF if there are no tasks.
+Can be used to decide how long the CPU can sleep.
+*/
+uint32_t scheduler_get_idle_time(void){
+	int32_t wait= 0;
+	
+	if(scheduler_task_count== 0){
+		return 0xFFFFFFFF;
+	}
+	wait= scheduler_next_release- timer_get_millis();
+	return (wait< 0)? 0: wait;
+}
+
+/*
+Copy the state and statistics of a task. Returns 'SCHEDULER_ERROR' if the id is not in use.
+*/
+uint8_t scheduler_get_task(uint8_t id, scheduler_task *task){
+	if(id>= SCHEDULER_MAX_TASKS || scheduler_table[id].function== 0){
+		return SCHEDULER_ERROR;
+	}
+	*task= scheduler_table[id];
+	return SCHEDULER_OK;
+}
+
+/*
+Clear the statistics of a task.
+*/
+void scheduler_clear_statistics(uint8_t id){
+	if(id>= SCHEDULER_MAX_TASKS){
+		return;
+	}
+	scheduler_table[id].max_lateness= 0;
+	scheduler_table[id].misses= 0;
+	scheduler_table[id].skipped= 0;
+	scheduler_table[id].runs= 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * scheduler.h
+ *
+ * Created: 19-Oct-26 5:02:44 PM
+ * Author: Ranul Deepanayake
+ * Cooperative task scheduler for the ATmega328P. Runs on the millisecond timebase of the Timer library (Timer 0 compare ISR).
+ * Tasks live in a static table and run to completion from 'scheduler_run' in the main loop. Periodic and one shot tasks are supported.
+ * Periodic tasks are released at fixed multiples of their period (no drift). Tasks that are due in the same pass run in table order.
+ * The next release time is cached, so 'scheduler_run' returns in constant time when nothing is due.
+ * Each task has a deadline (relative to its release). Lateness, deadline misses, and skipped releases are measured per task.
+ * Requires the Timer library set up with 'timer_set_millis'.
+ */ 
+
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+//Includes.
+#include "timer.h"
+
+//Defines.
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+#define SCHEDULER_ONE_SHOT 0				//Period of one shot tasks.
+#define SCHEDULER_NO_DEADLINE 0				//Deadline defaults to the period (one shot tasks: no deadline).
+
+//Status and error codes.
+#define SCHEDULER_OK 0
+#define SCHEDULER_ERROR 0xFF
+
+//Container for a task.
+struct scheduler_tasks{
+	void (*function)(void);		//0 if the slot is free.
+	uint32_t period;			//ms. 0 for one shot tasks.
+	uint32_t release;			//Next release time (ms).
+	uint32_t deadline;			//ms after the release.
+	uint16_t max_lateness;		//Largest delay between release and start (ms).
+	uint16_t misses;			//Runs that finished after the deadline.
+	uint16_t skipped;			//Periodic releases dropped because the task fell a whole period behind.
+	uint16_t runs;
+};
+
+typedef struct scheduler_tasks scheduler_task;
+
+//Functions.
+//Add a task. Returns the task id or 'SCHEDULER_ERROR' if the table is full.
+uint8_t scheduler_add(void (*function)(void), uint32_t delay, uint32_t period, uint32_t deadline);
+//Remove a task.
+void scheduler_remove(uint8_t id);
+//Run the tasks that are due. Returns the number of tasks run.
+uint8_t scheduler_run(void);
+//Return the time until the next release in ms (0 if a task is due).
+uint32_t scheduler_get_idle_time(void);
+//Copy the state and statistics of a task.
+uint8_t scheduler_get_task(uint8_t id, scheduler_task *task);
+//Clear the statistics of a task.
+void scheduler_clear_statistics(uint8_t id);
+
+//External variables.
+extern scheduler_task scheduler_table[SCHEDULER_MAX_TASKS];
+
+/*
+Example implementation. 50Hz control loop, 1Hz logging and a one shot start up task.
+
+#include "timer.h"
+#include "scheduler.h"
+
+void control(void){
+	//Read the ADC, update the output.
+}
+
+void logging(void){
+	//Print over UART.
+}
+
+void start_up(void){
+	//Runs once, 2 seconds after reset.
+}
+
+int main(void)
+{
+	uint8_t control_id;
+	scheduler_task statistics;
+	
+	timer_set_millis();
+	control_id= scheduler_add(control, 0, 20, 5);	//Must finish within 5ms of its release.
+	scheduler_add(logging, 0, 1000, SCHEDULER_NO_DEADLINE);
+	scheduler_add(start_up, 2000, SCHEDULER_ONE_SHOT, SCHEDULER_NO_DEADLINE);
+	
+	while (1)
+	{
+		scheduler_run();
+		scheduler_get_task(control_id, &statistics);	//statistics.misses, statistics.max_lateness.
+	}
+}
+
+*/
+
+#endif /* SCHEDULER_H_ */
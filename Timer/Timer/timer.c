@@ -7,19 +7,40 @@
 
 #include "timer.h"
 
-volatile uint16_t time_units= 0;	//Store the number of milliseconds or microseconds.
+volatile uint32_t timer_millis= 0;	//Store the number of milliseconds.
+volatile uint8_t timer_tickless= 0;	//Set while 'timer_sleep' has replaced the 1ms tick.
+volatile uint8_t timer_wake= 0;		//Set by the compare ISR that ends a sleep period.
 
 /*
 ISR increments time value on OC0A compare.
 */
 ISR(TIMER0_COMPA_vect){
-	time_units++;	//Increment the number of milliseconds or microseconds.
+	if(timer_tickless){
+		timer_wake= 1;	//'timer_sleep' accounts for the time.
+		return;
+	}
+	timer_millis++;	//Increment the number of milliseconds.
 }
 
+#ifdef TIMER_TICKLESS_TIMER2
+/*
+ISR ends a power save sleep period on OC2A compare.
+*/
+ISR(TIMER2_COMPA_vect){
+	timer_wake= 1;
+}
+#endif
+
 /*
 Set Timer 0 to count milliseconds. CTC mode with OC0A interrupt is used.
+Microseconds are available at the same time through 'timer_get_micros'.
+Claims the Timer 0 base and compare unit A. Returns 'TIMER_RESOURCE_ERROR' if another driver holds them.
 */
-void timer_set_millis(){
+uint8_t timer_set_millis(){
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_0, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A, TIMER_OWNER_TIMER, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){
+		return TIMER_RESOURCE_ERROR;
+	}
+	
 	//CTC mode is used.
 	TCCR0A= TIMER_OC0A_DISCONNECTED;	//OC0A disconnected.
 	TCCR0B= TIMER_MILLIS_PRESCALER;	//Set pre-scaler to 64.
@@ -27,38 +48,188 @@ void timer_set_millis(){
 	OCR0A= TIMER_MILLIS_OC0A;	//249 cycles: 1 millisecond.
 	sei();	//Enable global interrupts.
 	TCNT0= TIMER_TCNT0_RESET;	//Initialize timer.
+	return TIMER_RESOURCE_OK;
 }
 
 /*
-Set Timer 0 to count microseconds. CTC mode with OC0A interrupt is used.
+Same as 'timer_set_millis'. Milliseconds and microseconds share one timebase.
 */
-void timer_set_micros(){
-	TCCR0A= TIMER_OC0A_DISCONNECTED;	//OC0A disconnected.
-	TCCR0B= TIMER_MICROS_PRESCALER;	//Set pre-scaler to 8.
-	TIMSK0= TIMER_OC0A_INTERRUPT;	//Set OC0A interrupt.
-	OCR0A= TIMER_MICROS_OC0A;	//1 cycle: 1 microsecond.
-	sei();	//Enable global interrupts.
-	TCNT0= TIMER_TCNT0_RESET;	//Initialize timer.
+uint8_t timer_set_micros(){
+	return timer_set_millis();
 }
 
 /*
-Get elapsed milliseconds. Can store the maximum value of 65535 milliseconds.
+Get elapsed milliseconds. Wraps after 2^32 milliseconds (about 49.7 days).
 */
-uint16_t timer_get_millis(){
-	uint16_t temp;
-	cli();		//Temporarily disable global interrupts to prevent inconsistencies in the returned value due to partial writes to 'time_units'.
-	temp= time_units;
+uint32_t timer_get_millis(){
+	uint32_t temp;
+	cli();		//Temporarily disable global interrupts to prevent inconsistencies in the returned value due to partial writes to 'timer_millis'.
+	temp= timer_millis;
 	sei();		//Re-enable global interrupts.
 	return temp;
 }
 
 /*
-Get elapsed milliseconds. Can store the maximum value of 65535 microseconds.
+Get elapsed microseconds from the millisecond count and TCNT0. 4us resolution at 16MHz. Wraps after 2^32 microseconds (about 71.6 minutes).
+A compare match that hasn't been serviced yet (interrupts disabled) is accounted for.
 */
-uint16_t timer_get_micros(){
-	uint16_t temp;
-	cli();		//Temporarily disable global interrupts to prevent inconsistencies in the returned value due to partial writes of 'time_units'.
-	temp= time_units* TIMER_MILLIS_TO_MICROS_MULTIPLIER;
-	sei();		//Re-enable global interrupts.
-	return temp;
+uint32_t timer_get_micros(){
+	uint32_t milliseconds;
+	uint8_t ticks;
+	
+	cli();
+	milliseconds= timer_millis;
+	ticks= TCNT0;
+	if((TIFR0 & (1<< OCF0A)) && ticks< TIMER_MILLIS_OC0A){	//The counter has been cleared but the ISR hasn't run yet.
+		milliseconds++;
+	}
+	sei();
+	return milliseconds* 1000UL+ (uint16_t)ticks* TIMER_MICROS_PER_TICK;
+}
+
+#ifdef TIMER_TICKLESS_TIMER2
+/*
+Start Timer 2 from the 32.768kHz crystal (asynchronous, CTC mode, prescaler 128). Call once after 'timer_set_millis'.
+The crystal needs up to a second to stabilize after power up.
+Claims the Timer 2 base and compare unit A. Returns 'TIMER_RESOURCE_ERROR' if another driver holds them.
+*/
+uint8_t timer_tickless_set(){
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_2, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A, TIMER_OWNER_TICKLESS, TIMER_RESOURCE_EXCLUSIVE)!= TIMER_RESOURCE_OK){
+		return TIMER_RESOURCE_ERROR;
+	}
+	
+	TIMSK2= 0;
+	ASSR= (1<< AS2);
+	TCNT2= 0;
+	OCR2A= 0xFF;
+	TCCR2A= (1<< WGM21);
+	TCCR2B= TIMER2_ASYNC_PRESCALER;
+	while(ASSR & TIMER2_ASYNC_BUSY);	//Wait for the registers to be synchronized.
+	TIFR2= (1<< OCF2A) | (1<< OCF2B) | (1<< TOV2);
+	TIMSK2= (1<< OCIE2A);
+	return TIMER_RESOURCE_OK;
+}
+#endif
+
+/*
+Sleep until 'timer_wake' is set or another interrupt occurs.
+*/
+static void timer_sleep_cpu(uint8_t mode){
+	set_sleep_mode(mode);
+	cli();
+	if(!timer_wake){
+		sleep_enable();
+		sei();
+		sleep_cpu();	//The instruction after 'sei' always executes before an interrupt.
+		sleep_disable();
+	}
+	cli();
+}
+
+/*
+Sleep for up to 'duration' ms (at most 'TIMER_SLEEP_MAX') without the 1ms tick. Other interrupts end the sleep early.
+The slept time is added to the millisecond count on wake up and the 1ms tick resumes in phase, so no time is lost.
+Returns the number of ms the count advanced by. 'timer_set_millis' must have been called.
+Timer 0: idle mode, woken up at most every 16ms. 'TIMER_TICKLESS_TIMER2': power save mode, woken up at most every second.
+The prescaler is reset whenever a timer is started. Timer 1 shares the Timer 0 prescaler and may lose part of a prescaled tick each time.
+*/
+uint32_t timer_sleep(uint32_t duration){
+	uint32_t start= 0, target= 0, micros= 0;
+	uint16_t ticks= 0, elapsed= 0;
+	
+	if(duration== 0){
+		return 0;
+	}
+	if(duration> TIMER_SLEEP_MAX){
+		duration= TIMER_SLEEP_MAX;
+	}
+	
+	cli();
+	start= timer_millis;
+	TCCR0B= 0;	//Stop the 1ms tick. Keep the part of the current millisecond.
+	micros= TCNT0* TIMER_MICROS_PER_TICK;
+	if(TIFR0 & (1<< OCF0A)){	//A tick that hasn't been serviced yet.
+		TIFR0= (1<< OCF0A);
+		micros+= 1000;
+	}
+	target= duration* 1000UL;
+	timer_tickless= 1;
+	
+	#ifdef TIMER_TICKLESS_TIMER2
+	uint8_t quarters= 0;	//Fraction of a microsecond carried over.
+	
+	while(micros< target){
+		if(target- micros>= 1000000UL){
+			ticks= TIMER_TICKLESS_MAX_TICKS;	//Also keeps the multiplication below within 32 bits.
+		}else{
+			ticks= ((target- micros)* 4)/ TIMER2_ASYNC_QUARTER_MICROS_PER_TICK;
+			if(ticks== 0){
+				break;
+			}
+		}
+		TCNT2= 0;
+		OCR2A= ticks- 1;
+		while(ASSR & TIMER2_ASYNC_BUSY);
+		GTCCR= (1<< PSRASY);	//Restart the prescaler so the first tick is a full one.
+		while(GTCCR & (1<< PSRASY));	//Cleared once the asynchronous prescaler has been reset.
+		TIFR2= (1<< OCF2A);
+		timer_wake= 0;
+		timer_sleep_cpu(SLEEP_MODE_PWR_SAVE);
+		
+		OCR2B= 0;	//Wait for a TOSC1 cycle so TCNT2 reads correctly after waking up.
+		while(ASSR & (1<< OCR2BUB));
+		if(timer_wake || (TIFR2 & (1<< OCF2A))){
+			elapsed= ticks;
+			TIFR2= (1<< OCF2A);
+		}else{
+			elapsed= TCNT2;
+		}
+		micros+= (elapsed* TIMER2_ASYNC_QUARTER_MICROS_PER_TICK+ quarters)>> 2;
+		quarters= (elapsed* TIMER2_ASYNC_QUARTER_MICROS_PER_TICK+ quarters) & 0x03;
+		if(elapsed!= ticks){
+			break;	//Woken up by another interrupt.
+		}
+	}
+	#else
+	TIMSK0= TIMER_OC0A_INTERRUPT;
+	while(micros< target){
+		ticks= (target- micros)/ TIMER_TICKLESS_MICROS_PER_TICK;
+		if(ticks== 0){
+			break;
+		}
+		if(ticks> TIMER_TICKLESS_MAX_TICKS){
+			ticks= TIMER_TICKLESS_MAX_TICKS;
+		}
+		TCNT0= 0;
+		OCR0A= ticks- 1;
+		TIFR0= (1<< OCF0A);
+		timer_wake= 0;
+		GTCCR= (1<< PSRSYNC);	//Restart the prescaler so the first tick is a full one.
+		TCCR0B= TIMER_TICKLESS_PRESCALER;
+		timer_sleep_cpu(SLEEP_MODE_IDLE);
+		
+		TCCR0B= 0;
+		if(timer_wake || (TIFR0 & (1<< OCF0A))){
+			elapsed= ticks;
+			TIFR0= (1<< OCF0A);
+		}else{
+			elapsed= TCNT0;
+		}
+		micros+= (uint32_t)elapsed* TIMER_TICKLESS_MICROS_PER_TICK;
+		if(elapsed!= ticks){
+			break;	//Woken up by another interrupt.
+		}
+	}
+	#endif
+	
+	//Resume the 1ms tick with the remaining part of a millisecond in the counter.
+	timer_tickless= 0;
+	timer_millis+= micros/ 1000;
+	OCR0A= TIMER_MILLIS_OC0A;
+	TCNT0= (micros% 1000)/ TIMER_MICROS_PER_TICK;
+	TIFR0= (1<< OCF0A);
+	GTCCR= (1<< PSRSYNC);
+	TCCR0B= TIMER_MILLIS_PRESCALER;
+	sei();
+	return timer_millis- start;
 }
@@ -4,7 +4,13 @@
  * Created: 29-Jan-19 4:07:20 PM
  * Author: Ranul Deepanayake
  * Timer library for the ATmega328P clocked at 16MHz. Uses Timer 0.
- * Can measure elapsed milliseconds and microseconds (both modes can't run at the same time).
+ * Counts elapsed milliseconds in 32 bits (wraps after about 49.7 days).
+ * Microseconds are derived from the millisecond count and TCNT0 (4us resolution at 16MHz), so both can be read at the same time.
+ * Use unsigned differences ('now- previous') for intervals. They stay correct across the wrap around.
+ * Supports tickless idle: 'timer_sleep' stops the 1ms tick, sleeps until a deadline and adds the slept time to the count on wake up.
+ * By default Timer 0 keeps time with long compare periods in idle sleep mode (up to 16ms per wake up instead of 1ms).
+ * With a 32.768kHz crystal on TOSC1/ TOSC2, define 'TIMER_TICKLESS_TIMER2' to keep time with asynchronous Timer 2 in power save mode
+ * (up to 1s per wake up). Timer 2 can't be used for anything else then.
  */ 
 
 
@@ -14,28 +20,69 @@
 //Includes.
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "timerresource.h"
 
 //Attributes.
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
 #define TIMER_OC0A_DISCONNECTED 0x02
 #define TIMER_OC0A_INTERRUPT 0x02
 #define TIMER_TCNT0_RESET 0x00
 #define TIMER_MILLIS_PRESCALER 0x03
-#define TIMER_MICROS_PRESCALER 0x03
-#define TIMER_MILLIS_OC0A 0xF9
-#define TIMER_MICROS_OC0A 0x01
-#define TIMER_MILLIS_TO_MICROS_MULTIPLIER 8
+#define TIMER_TICKS_PER_MILLI (F_CPU/ 64000UL)					//250 at 16MHz.
+#define TIMER_MILLIS_OC0A (TIMER_TICKS_PER_MILLI- 1)			//249 at 16MHz.
+#define TIMER_MICROS_PER_TICK (1000UL/ TIMER_TICKS_PER_MILLI)	//4 at 16MHz, 8 at 8MHz.
+
+//Tickless idle.
+//#define TIMER_TICKLESS_TIMER2		//Uncomment to sleep in power save mode with asynchronous Timer 2 (needs a 32.768kHz crystal).
+#define TIMER_SLEEP_MAX 3600000UL								//Longest sleep (ms).
+#define TIMER_TICKLESS_PRESCALER 0x05							//Timer 0 prescaler 1024.
+#define TIMER_TICKLESS_MICROS_PER_TICK (1024000000UL/ F_CPU)	//64 at 16MHz.
+#define TIMER_TICKLESS_MAX_TICKS 256
+#define TIMER2_ASYNC_PRESCALER 0x05								//Timer 2 prescaler 128. 256Hz.
+#define TIMER2_ASYNC_QUARTER_MICROS_PER_TICK 15625UL			//3906.25us in quarter microseconds.
+#define TIMER2_ASYNC_BUSY ((1<< TCN2UB) | (1<< OCR2AUB) | (1<< OCR2BUB) | (1<< TCR2AUB) | (1<< TCR2BUB))
 
 //Functions.
-//Set timer to count milliseconds.
-void timer_set_millis();
-//Set timer to count microseconds.
-void timer_set_micros();		
+//Set timer to count milliseconds and microseconds.
+uint8_t timer_set_millis();
+//Same as 'timer_set_millis'. Kept for compatibility.
+uint8_t timer_set_micros();		
 //Get milliseconds.
-uint16_t timer_get_millis();
+uint32_t timer_get_millis();
 //Get microseconds.				 
-uint16_t timer_get_micros();
+uint32_t timer_get_micros();
+#ifdef TIMER_TICKLESS_TIMER2
+//Start the asynchronous Timer 2 for tickless idle.
+uint8_t timer_tickless_set();
+#endif
+//Sleep without the 1ms tick for up to 'duration' ms or until another interrupt. Returns the ms slept.
+uint32_t timer_sleep(uint32_t duration);
+
+//External variables.
+extern volatile uint32_t timer_millis;
 
 /*
+Example implementation. Tickless idle with the scheduler.
+
+#include "timer.h"
+#include "scheduler.h"
+
+int main(void)
+{
+	timer_set_millis();
+	scheduler_add(measure, 0, 5000, SCHEDULER_NO_DEADLINE);
+	
+	while (1)
+	{
+		scheduler_run();
+		timer_sleep(scheduler_get_idle_time());	//Wakes up early on other interrupts (e.g. UART).
+	}
+}
+
 Example implementation.
 
 #include <avr/io.h>
@@ -43,7 +90,7 @@ Example implementation.
 
 int main(void)
 {
-	uint16_t previous_time= 0, current_time= 0, on_time= 500, total_time= 1000;
+	uint32_t previous_time= 0, current_time= 0, on_time= 500, total_time= 1000;
 	timer_set_millis();
 	DDRB|= 0x20;
 	
@@ -63,4 +110,4 @@ int main(void)
 
 */
 
-#endif /* TIMER_H_ */
\ No newline at end of file
+#endif /* TIMER_H_ */
@@ -0,0 +1,118 @@
+/*
+ * timerresource.c
+ *
+ * Created: 19-Oct-26 7:48:10 PM
+ * Author: Ranul Deepanayake
+ */ 
+
+#include "timerresource.h"
+
+timer_resource timer_resource_table[TIMER_RESOURCE_TIMERS];	//Owners of every timer.
+
+/*
+Check if a resource can be claimed. The base can be shared by owners with the same non zero configuration.
+*/
+static uint8_t timer_resource_available(timer_resource *timer, uint8_t channel, uint8_t owner, uint8_t config){
+	uint8_t current= timer->owner[channel];
+	
+	if(current== TIMER_OWNER_NONE || current== owner){
+		return 1;
+	}
+	if(channel== 0 && config!= TIMER_RESOURCE_EXCLUSIVE && config== timer->base_config){
+		return 1;	//Shared base.
+	}
+	return 0;
+}
+
+/*
+Claim resources of a timer ('TIMER_RESOURCE_BASE', '_COMPARE_A', '_COMPARE_B', '_CAPTURE'). All or nothing.
+'config' is 'TIMER_RESOURCE_EXCLUSIVE' or the configuration id the base is shared under.
+Claiming resources the owner already holds succeeds. Returns 'TIMER_RESOURCE_ERROR' if any resource is held by another owner.
+*/
+uint8_t timer_resource_claim(uint8_t timer, uint8_t resources, uint8_t owner, uint8_t config){
+	timer_resource *entry;
+	uint8_t sreg;
+	
+	if(timer>= TIMER_RESOURCE_TIMERS || owner== TIMER_OWNER_NONE || owner> 15){
+		return TIMER_RESOURCE_ERROR;
+	}
+	entry= &timer_resource_table[timer];
+	if((resources & TIMER_RESOURCE_CAPTURE) && timer!= TIMER_RESOURCE_TIMER_1){
+		return TIMER_RESOURCE_ERROR;
+	}
+	
+	sreg= SREG;	//Drivers can claim and release from ISRs. Keep the interrupt state.
+	cli();
+	for(uint8_t i= 0; i< TIMER_RESOURCE_CHANNELS; i++){
+		if((resources & (1<< i)) && !timer_resource_available(entry, i, owner, config)){
+			SREG= sreg;
+			return TIMER_RESOURCE_ERROR;
+		}
+	}
+	for(uint8_t i= 0; i< TIMER_RESOURCE_CHANNELS; i++){
+		if(resources & (1<< i)){
+			if(entry->owner[i]== TIMER_OWNER_NONE){
+				entry->owner[i]= owner;
+			}
+		}
+	}
+	if(resources & TIMER_RESOURCE_BASE){
+		if(entry->base_owners== 0){
+			entry->base_config= config;
+		}
+		entry->base_owners|= (1<< owner);
+	}
+	SREG= sreg;
+	return TIMER_RESOURCE_OK;
+}
+
+/*
+Release every resource an owner holds on a timer. A shared base is passed on to a remaining sharer.
+The timer itself is left as it is. Stop it before releasing if needed.
+*/
+void timer_resource_release(uint8_t timer, uint8_t owner){
+	timer_resource *entry;
+	uint8_t sreg;
+	
+	if(timer>= TIMER_RESOURCE_TIMERS || owner== TIMER_OWNER_NONE || owner> 15){
+		return;
+	}
+	entry= &timer_resource_table[timer];
+	
+	sreg= SREG;
+	cli();
+	for(uint8_t i= 1; i< TIMER_RESOURCE_CHANNELS; i++){
+		if(entry->owner[i]== owner){
+			entry->owner[i]= TIMER_OWNER_NONE;
+		}
+	}
+	entry->base_owners&= ~(1<< owner);
+	if(entry->owner[0]== owner){
+		entry->owner[0]= TIMER_OWNER_NONE;
+		for(uint8_t i= 1; i< 16; i++){	//Pass the base on.
+			if(entry->base_owners & (1<< i)){
+				entry->owner[0]= i;
+				break;
+			}
+		}
+	}
+	if(entry->base_owners== 0){
+		entry->base_config= TIMER_RESOURCE_EXCLUSIVE;
+	}
+	SREG= sreg;
+}
+
+/*
+Return the owner of a resource ('TIMER_RESOURCE_BASE', '_COMPARE_A', '_COMPARE_B', '_CAPTURE'). 'TIMER_OWNER_NONE' if it is free.
+*/
+uint8_t timer_resource_get_owner(uint8_t timer, uint8_t resource){
+	if(timer>= TIMER_RESOURCE_TIMERS){
+		return TIMER_OWNER_NONE;
+	}
+	for(uint8_t i= 0; i< TIMER_RESOURCE_CHANNELS; i++){
+		if(resource== (1<< i)){
+			return timer_resource_table[timer].owner[i];
+		}
+	}
+	return TIMER_OWNER_NONE;
+}
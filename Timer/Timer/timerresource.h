@@ -0,0 +1,170 @@
+/*
+ * timerresource.h
+ *
+ * Created: 19-Oct-26 7:48:27 PM
+ * Author: Ranul Deepanayake
+ * Timer resource manager for the ATmega328P. Keeps track of which driver holds which timer and which of its channels.
+ * The resources of a timer are its base (counter, mode and prescaler), compare units A and B, and the Timer 1 input capture unit.
+ * Runtime: drivers claim resources before touching a timer and release them when done. Claims of resources held by another driver fail.
+ * A base can be shared by drivers that need the exact same mode and prescaler (same configuration id), e.g. a servo and a PWM output on Timer 1.
+ * Compile time: list the drivers of an application in 'TIMER_RESOURCE_USE_1'- 'TIMER_RESOURCE_USE_8' (compiler flags or before including this file).
+ * Overlapping exclusive resources stop the build with an error.
+ * The Timer, DHT11, ADC (timer triggers), Servo, Analog Write, Input Capture and Profiler libraries claim their timers themselves.
+ */ 
+
+
+#ifndef TIMERRESOURCE_H_
+#define TIMERRESOURCE_H_
+
+//Includes.
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+//Timers.
+#define TIMER_RESOURCE_TIMER_0 0
+#define TIMER_RESOURCE_TIMER_1 1
+#define TIMER_RESOURCE_TIMER_2 2
+#define TIMER_RESOURCE_TIMERS 3
+
+//Resources of a timer (bit mask).
+#define TIMER_RESOURCE_BASE 0x01
+#define TIMER_RESOURCE_COMPARE_A 0x02
+#define TIMER_RESOURCE_COMPARE_B 0x04
+#define TIMER_RESOURCE_CAPTURE 0x08			//Timer 1 only.
+#define TIMER_RESOURCE_CHANNELS 4
+
+//Owners.
+#define TIMER_OWNER_NONE 0
+#define TIMER_OWNER_TIMER 1
+#define TIMER_OWNER_TICKLESS 2
+#define TIMER_OWNER_SERVO 3
+#define TIMER_OWNER_ANALOG_WRITE 4
+#define TIMER_OWNER_ADC 5
+#define TIMER_OWNER_DHT11 6
+#define TIMER_OWNER_CAPTURE 7
+#define TIMER_OWNER_PROFILER 8
+#define TIMER_OWNER_USER 9					//Application owners from here on (up to 15).
+
+//Base configurations. Drivers with the same non zero configuration can share a base.
+#define TIMER_RESOURCE_EXCLUSIVE 0
+#define TIMER_RESOURCE_CONFIG_FREE_RUNNING_1 1	//Timer 1 normal mode, prescaler 1 (capture, profiler).
+#define TIMER_RESOURCE_CONFIG_SERVO_50HZ 2		//Timer 1 mode 10, prescaler 8, ICR1= 20000 (servo, PWM on the other channel).
+#define TIMER_RESOURCE_CONFIG_USER 16			//Application configurations from here on.
+
+//Compile time usage masks. Bits 0- 3 Timer 0, 4- 7 Timer 1, 8- 11 Timer 2 (base, A, B, capture).
+//Every driver that sets the waveform mode or the prescaler includes the base.
+//Drivers sharing a base at runtime are listed together in one entry (e.g. 'TIMER_RESOURCE_INPUT_CAPTURE | TIMER_RESOURCE_PROFILER').
+#define TIMER_RESOURCE_MASK(timer, resources) ((resources)<< ((timer)* 4))	//No casts. Evaluated by the preprocessor.
+#define TIMER_RESOURCE_TIMER_LIBRARY TIMER_RESOURCE_MASK(0, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A)
+#define TIMER_RESOURCE_TIMER_TICKLESS_TIMER2 TIMER_RESOURCE_MASK(2, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A)
+#define TIMER_RESOURCE_SERVO TIMER_RESOURCE_MASK(1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A | TIMER_RESOURCE_COMPARE_B)
+#define TIMER_RESOURCE_DHT11_CAPTURE TIMER_RESOURCE_MASK(2, TIMER_RESOURCE_BASE)
+#define TIMER_RESOURCE_ADC_TIMER0_TRIGGER TIMER_RESOURCE_MASK(0, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A)
+#define TIMER_RESOURCE_ADC_TIMER1_TRIGGER TIMER_RESOURCE_MASK(1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A | TIMER_RESOURCE_COMPARE_B)
+#define TIMER_RESOURCE_INPUT_CAPTURE TIMER_RESOURCE_MASK(1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_CAPTURE)
+#define TIMER_RESOURCE_PROFILER TIMER_RESOURCE_MASK(1, TIMER_RESOURCE_BASE)
+#define TIMER_RESOURCE_ANALOG_WRITE(timer, compare) TIMER_RESOURCE_MASK(timer, TIMER_RESOURCE_BASE | (compare))
+#define TIMER_RESOURCE_ANALOG_WRITE_FREQUENCY TIMER_RESOURCE_MASK(1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_A)
+
+//Compile time check. Each listed driver must not overlap the ones before it.
+#ifndef TIMER_RESOURCE_USE_1
+#define TIMER_RESOURCE_USE_1 0
+#endif
+#ifndef TIMER_RESOURCE_USE_2
+#define TIMER_RESOURCE_USE_2 0
+#endif
+#ifndef TIMER_RESOURCE_USE_3
+#define TIMER_RESOURCE_USE_3 0
+#endif
+#ifndef TIMER_RESOURCE_USE_4
+#define TIMER_RESOURCE_USE_4 0
+#endif
+#ifndef TIMER_RESOURCE_USE_5
+#define TIMER_RESOURCE_USE_5 0
+#endif
+#ifndef TIMER_RESOURCE_USE_6
+#define TIMER_RESOURCE_USE_6 0
+#endif
+#ifndef TIMER_RESOURCE_USE_7
+#define TIMER_RESOURCE_USE_7 0
+#endif
+#ifndef TIMER_RESOURCE_USE_8
+#define TIMER_RESOURCE_USE_8 0
+#endif
+#if (TIMER_RESOURCE_USE_2) & (TIMER_RESOURCE_USE_1)
+#error "TIMER_RESOURCE_USE_2 needs a timer resource that is already used."
+#endif
+#if (TIMER_RESOURCE_USE_3) & ((TIMER_RESOURCE_USE_1) | (TIMER_RESOURCE_USE_2))
+#error "TIMER_RESOURCE_USE_3 needs a timer resource that is already used."
+#endif
+#if (TIMER_RESOURCE_USE_4) & ((TIMER_RESOURCE_USE_1) | (TIMER_RESOURCE_USE_2) | (TIMER_RESOURCE_USE_3))
+#error "TIMER_RESOURCE_USE_4 needs a timer resource that is already used."
+#endif
+#if (TIMER_RESOURCE_USE_5) & ((TIMER_RESOURCE_USE_1) | (TIMER_RESOURCE_USE_2) | (TIMER_RESOURCE_USE_3) | (TIMER_RESOURCE_USE_4))
+#error "TIMER_RESOURCE_USE_5 needs a timer resource that is already used."
+#endif
+#if (TIMER_RESOURCE_USE_6) & ((TIMER_RESOURCE_USE_1) | (TIMER_RESOURCE_USE_2) | (TIMER_RESOURCE_USE_3) | (TIMER_RESOURCE_USE_4) | (TIMER_RESOURCE_USE_5))
+#error "TIMER_RESOURCE_USE_6 needs a timer resource that is already used."
+#endif
+#if (TIMER_RESOURCE_USE_7) & ((TIMER_RESOURCE_USE_1) | (TIMER_RESOURCE_USE_2) | (TIMER_RESOURCE_USE_3) | (TIMER_RESOURCE_USE_4) | (TIMER_RESOURCE_USE_5) | (TIMER_RESOURCE_USE_6))
+#error "TIMER_RESOURCE_USE_7 needs a timer resource that is already used."
+#endif
+#if (TIMER_RESOURCE_USE_8) & ((TIMER_RESOURCE_USE_1) | (TIMER_RESOURCE_USE_2) | (TIMER_RESOURCE_USE_3) | (TIMER_RESOURCE_USE_4) | (TIMER_RESOURCE_USE_5) | (TIMER_RESOURCE_USE_6) | (TIMER_RESOURCE_USE_7))
+#error "TIMER_RESOURCE_USE_8 needs a timer resource that is already used."
+#endif
+
+//Status and error codes.
+#define TIMER_RESOURCE_OK 0
+#define TIMER_RESOURCE_ERROR 1
+
+//Container for the owners of a timer.
+struct timer_resources{
+	uint8_t owner[TIMER_RESOURCE_CHANNELS];	//Owner of the base, compare A, compare B and capture.
+	uint16_t base_owners;					//Owners sharing the base (bit per owner).
+	uint8_t base_config;					//Configuration of a shared base.
+};
+
+typedef struct timer_resources timer_resource;
+
+//Functions.
+//Claim resources of a timer. All or nothing.
+uint8_t timer_resource_claim(uint8_t timer, uint8_t resources, uint8_t owner, uint8_t config);
+//Release every resource an owner holds on a timer.
+void timer_resource_release(uint8_t timer, uint8_t owner);
+//Return the owner of a resource (the first owner of a shared base).
+uint8_t timer_resource_get_owner(uint8_t timer, uint8_t resource);
+
+//External variables.
+extern timer_resource timer_resource_table[TIMER_RESOURCE_TIMERS];
+
+/*
+Example implementation. Compile time check (in the compiler flags or before the first include).
+
+#define TIMER_RESOURCE_USE_1 TIMER_RESOURCE_TIMER_LIBRARY
+#define TIMER_RESOURCE_USE_2 TIMER_RESOURCE_SERVO
+#define TIMER_RESOURCE_USE_3 TIMER_RESOURCE_ANALOG_WRITE(2, TIMER_RESOURCE_COMPARE_A)
+#define TIMER_RESOURCE_USE_4 TIMER_RESOURCE_ANALOG_WRITE(0, TIMER_RESOURCE_COMPARE_B)	//Error: Timer 0 is used by the Timer library.
+#include "timerresource.h"
+
+Example implementation. Runtime claims. A servo on OCR1A and a 50Hz PWM output on OCR1B share the Timer 1 base.
+
+#include "timerresource.h"
+#include "servo.h"
+
+int main(void)
+{
+	servo_set(SERVO_0);		//Claims the base and compare A with 'TIMER_RESOURCE_CONFIG_SERVO_50HZ'.
+	if(timer_resource_claim(TIMER_RESOURCE_TIMER_1, TIMER_RESOURCE_BASE | TIMER_RESOURCE_COMPARE_B, TIMER_OWNER_ANALOG_WRITE, TIMER_RESOURCE_CONFIG_SERVO_50HZ)== TIMER_RESOURCE_OK){
+		TCCR1A|= TIMER_COMPARE_B_OUTPUT_MODE_NON_INVERTED;
+		OCR1B= 10000;		//50% duty cycle.
+	}
+	
+	while (1)
+	{
+		
+	}
+}
+
+*/
+
+#endif /* TIMERRESOURCE_H_ */
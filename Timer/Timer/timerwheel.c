@@ -0,0 +1,192 @@
+/*
+ * timerwheel.c
+ *
+ * Created: 19-Oct-26 6:20:02 PM
+ * Author: Ranul Deepanayake
+ */ 
+
+#include "timerwheel.h"
+
+timer_wheel_node timer_wheel_pool[TIMER_WHEEL_POOL_SIZE];	//Static timer pool.
+uint8_t timer_wheel_slots[TIMER_WHEEL_SLOTS];	//First timer of every slot.
+uint8_t timer_wheel_free_list= TIMER_WHEEL_NONE;	//First free timer (linked through 'next').
+uint8_t timer_wheel_free_count= 0;
+uint8_t timer_wheel_current= 0;					//Last visited slot.
+uint32_t timer_wheel_time= 0;					//Time of the last tick (ms).
+
+/*
+Return a timer to the pool.
+*/
+static void timer_wheel_free(uint8_t id){
+	timer_wheel_pool[id].state= TIMER_WHEEL_FREE;
+	timer_wheel_pool[id].next= timer_wheel_free_list;
+	timer_wheel_free_list= id;
+	timer_wheel_free_count++;
+}
+
+/*
+Insert a timer at the head of the slot 'timeout' ms from now.
+The current slot lags the time by the ticks that 'timer_wheel_update' hasn't processed yet, so those are added.
+*/
+static void timer_wheel_insert(uint8_t id, uint32_t timeout){
+	timer_wheel_node *node= &timer_wheel_pool[id];
+	uint32_t ticks= timeout/ TIMER_WHEEL_RESOLUTION;
+	uint8_t slot= 0;
+	
+	if(ticks== 0){
+		ticks= 1;		//Expires on the next tick.
+	}
+	ticks+= (timer_get_millis()- timer_wheel_time)/ TIMER_WHEEL_RESOLUTION;
+	if(((ticks- 1)>> TIMER_WHEEL_SLOT_BITS)> 0xFFFF){
+		ticks= (0x10000UL<< TIMER_WHEEL_SLOT_BITS);	//Only the ticks the wheel is behind can push it past the longest timeout.
+	}
+	slot= (timer_wheel_current+ ticks) & TIMER_WHEEL_SLOT_MASK;
+	
+	node->rounds= (ticks- 1)>> TIMER_WHEEL_SLOT_BITS;
+	node->slot= slot;
+	node->state= TIMER_WHEEL_ACTIVE;
+	node->previous= TIMER_WHEEL_NONE;
+	node->next= timer_wheel_slots[slot];
+	if(node->next!= TIMER_WHEEL_NONE){
+		timer_wheel_pool[node->next].previous= id;
+	}
+	timer_wheel_slots[slot]= id;
+}
+
+/*
+Remove an active timer from its slot.
+*/
+static void timer_wheel_unlink(uint8_t id){
+	timer_wheel_node *node= &timer_wheel_pool[id];
+	
+	if(node->previous!= TIMER_WHEEL_NONE){
+		timer_wheel_pool[node->previous].next= node->next;
+	}else{
+		timer_wheel_slots[node->slot]= node->next;
+	}
+	if(node->next!= TIMER_WHEEL_NONE){
+		timer_wheel_pool[node->next].previous= node->previous;
+	}
+}
+
+/*
+Set up the timer wheel. All timers are returned to the pool.
+*/
+void timer_wheel_set(void){
+	for(uint8_t i= 0; i< TIMER_WHEEL_SLOTS; i++){
+		timer_wheel_slots[i]= TIMER_WHEEL_NONE;
+	}
+	timer_wheel_free_list= TIMER_WHEEL_NONE;
+	timer_wheel_free_count= 0;
+	for(uint8_t i= TIMER_WHEEL_POOL_SIZE; i> 0; i--){
+		timer_wheel_free(i- 1);
+	}
+	timer_wheel_current= 0;
+	timer_wheel_time= timer_get_millis();
+}
+
+/*
+Start a timer that calls 'callback' once after 'timeout' ms (rounded down to 'TIMER_WHEEL_RESOLUTION', at least one tick).
+Returns the timer id or 'TIMER_WHEEL_ERROR' if the pool is empty or the timeout is above 'TIMER_WHEEL_MAX_TIMEOUT'.
+The id is free again once the callback runs or the timer is cancelled.
+*/
+uint8_t timer_wheel_add(uint32_t timeout, void (*callback)(uint8_t id)){
+	uint8_t id= timer_wheel_free_list;
+	
+	if(id== TIMER_WHEEL_NONE || callback== 0 || timeout> TIMER_WHEEL_MAX_TIMEOUT){
+		return TIMER_WHEEL_ERROR;
+	}
+	timer_wheel_free_list= timer_wheel_pool[id].next;
+	timer_wheel_free_count--;
+	
+	timer_wheel_pool[id].callback= callback;
+	timer_wheel_insert(id, timeout);
+	return id;
+}
+
+/*
+Restart a running timer with a new timeout. Keeps the id and the callback.
+Returns 'TIMER_WHEEL_ERROR' if the timer isn't running (expired, cancelled or invalid) or the timeout is above 'TIMER_WHEEL_MAX_TIMEOUT'.
+The timer keeps its old timeout in that case.
+*/
+uint8_t timer_wheel_restart(uint8_t id, uint32_t timeout){
+	if(id>= TIMER_WHEEL_POOL_SIZE || timer_wheel_pool[id].state!= TIMER_WHEEL_ACTIVE || timeout> TIMER_WHEEL_MAX_TIMEOUT){
+		return TIMER_WHEEL_ERROR;
+	}
+	timer_wheel_unlink(id);
+	timer_wheel_insert(id, timeout);
+	return TIMER_WHEEL_OK;
+}
+
+/*
+Cancel a timer. Its callback won't run. Returns 'TIMER_WHEEL_ERROR' if the timer isn't running.
+*/
+uint8_t timer_wheel_cancel(uint8_t id){
+	if(id>= TIMER_WHEEL_POOL_SIZE){
+		return TIMER_WHEEL_ERROR;
+	}
+	if(timer_wheel_pool[id].state== TIMER_WHEEL_ACTIVE){
+		timer_wheel_unlink(id);
+		timer_wheel_free(id);
+		return TIMER_WHEEL_OK;
+	}
+	if(timer_wheel_pool[id].state== TIMER_WHEEL_EXPIRING){	//Expired in this update but its callback hasn't run yet.
+		timer_wheel_pool[id].state= TIMER_WHEEL_CANCELLED;
+		return TIMER_WHEEL_OK;
+	}
+	return TIMER_WHEEL_ERROR;
+}
+
+/*
+Advance the wheel to the current time, one slot per tick, and run the callbacks of expired timers.
+Expired timers are collected first and their callbacks run afterwards, so callbacks can change any timer.
+Call at least once per tick for accurate timeouts. Returns the number of expired timers.
+*/
+uint8_t timer_wheel_update(void){
+	uint32_t now= timer_get_millis();
+	uint8_t expired= TIMER_WHEEL_NONE;
+	uint8_t count= 0;
+	
+	while(now- timer_wheel_time>= TIMER_WHEEL_RESOLUTION){
+		uint8_t id= 0;
+		
+		timer_wheel_time+= TIMER_WHEEL_RESOLUTION;
+		timer_wheel_current= (timer_wheel_current+ 1) & TIMER_WHEEL_SLOT_MASK;
+		
+		id= timer_wheel_slots[timer_wheel_current];
+		while(id!= TIMER_WHEEL_NONE){
+			uint8_t next= timer_wheel_pool[id].next;
+			
+			if(timer_wheel_pool[id].rounds){
+				timer_wheel_pool[id].rounds--;
+			}else{	//Expired. Move it to the expired list.
+				timer_wheel_unlink(id);
+				timer_wheel_pool[id].state= TIMER_WHEEL_EXPIRING;
+				timer_wheel_pool[id].next= expired;
+				expired= id;
+			}
+			id= next;
+		}
+	}
+	
+	while(expired!= TIMER_WHEEL_NONE){
+		uint8_t id= expired;
+		uint8_t state= timer_wheel_pool[id].state;
+		void (*callback)(uint8_t id)= timer_wheel_pool[id].callback;
+		
+		expired= timer_wheel_pool[id].next;
+		timer_wheel_free(id);	//Free before the callback so it can start a new timer.
+		if(state== TIMER_WHEEL_EXPIRING){
+			callback(id);
+			count++;
+		}
+	}
+	return count;
+}
+
+/*
+Return the number of free timers in the pool.
+*/
+uint8_t timer_wheel_get_free(void){
+	return timer_wheel_free_count;
+}
@@ -0,0 +1,107 @@
+/*
+ * timerwheel.h
+ *
+ * Created: 19-Oct-26 6:20:15 PM
+ * Author: Ranul Deepanayake
+ * Hashed timer wheel for software timeouts. Runs on the millisecond timebase of the Timer library.
+ * Timers come from a fixed static pool (no heap). Adding and cancelling a timer takes constant time.
+ * Each tick visits one wheel slot. A slot holds the timers that expire in that slot, or whole turns of the wheel later.
+ * Timeouts are limited to 2^16 turns of the wheel ('TIMER_WHEEL_MAX_TIMEOUT'). Longer ones are refused.
+ * Callbacks run from 'timer_wheel_update' in the main loop, never from an ISR. They can add, restart and cancel timers.
+ * Requires the Timer library set up with 'timer_set_millis'.
+ */ 
+
+
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+//Includes.
+#include "timer.h"
+
+//Defines.
+#ifndef TIMER_WHEEL_POOL_SIZE
+#define TIMER_WHEEL_POOL_SIZE 32			//Timers that can be outstanding at the same time (maximum 254).
+#endif
+#ifndef TIMER_WHEEL_SLOT_BITS
+#define TIMER_WHEEL_SLOT_BITS 4				//2^n slots. More slots mean fewer timers per slot.
+#endif
+#ifndef TIMER_WHEEL_RESOLUTION
+#define TIMER_WHEEL_RESOLUTION 1			//ms per tick.
+#endif
+#define TIMER_WHEEL_SLOTS (1<< TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS- 1)
+#define TIMER_WHEEL_NONE 0xFF				//End of a list.
+#define TIMER_WHEEL_MAX_TIMEOUT ((0x10000UL<< TIMER_WHEEL_SLOT_BITS)* TIMER_WHEEL_RESOLUTION)	//Longest timeout (ms). 2^20ms (about 17.5 minutes) with the defaults.
+
+//Timer states.
+#define TIMER_WHEEL_FREE 0
+#define TIMER_WHEEL_ACTIVE 1
+#define TIMER_WHEEL_EXPIRING 2
+#define TIMER_WHEEL_CANCELLED 3
+
+//Status and error codes.
+#define TIMER_WHEEL_OK 0
+#define TIMER_WHEEL_ERROR 0xFF
+
+//Container for a timer.
+struct timer_wheel_nodes{
+	void (*callback)(uint8_t id);
+	uint16_t rounds;		//Whole turns of the wheel left.
+	uint8_t next;			//Pool index of the next timer in the list.
+	uint8_t previous;
+	uint8_t slot;
+	uint8_t state;
+};
+
+typedef struct timer_wheel_nodes timer_wheel_node;
+
+//Functions.
+//Set up the timer wheel. Cancels all timers.
+void timer_wheel_set(void);
+//Start a timer. Returns the timer id or 'TIMER_WHEEL_ERROR' if the pool is empty or the timeout is above 'TIMER_WHEEL_MAX_TIMEOUT'.
+uint8_t timer_wheel_add(uint32_t timeout, void (*callback)(uint8_t id));
+//Restart a running timer with a new timeout (at most 'TIMER_WHEEL_MAX_TIMEOUT'). Keeps the id.
+uint8_t timer_wheel_restart(uint8_t id, uint32_t timeout);
+//Cancel a timer.
+uint8_t timer_wheel_cancel(uint8_t id);
+//Advance the wheel to the current time and run the callbacks of expired timers. Returns the number of expired timers.
+uint8_t timer_wheel_update(void);
+//Return the number of free timers in the pool.
+uint8_t timer_wheel_get_free(void);
+
+//External variables.
+extern timer_wheel_node timer_wheel_pool[TIMER_WHEEL_POOL_SIZE];
+
+/*
+Example implementation. A UART frame timeout that is restarted by every received byte.
+
+#include "timer.h"
+#include "timerwheel.h"
+
+uint8_t frame_timer= TIMER_WHEEL_ERROR;
+
+void frame_timeout(uint8_t id){
+	frame_timer= TIMER_WHEEL_ERROR;
+	//Discard the partial frame.
+}
+
+int main(void)
+{
+	timer_set_millis();
+	timer_wheel_set();
+	
+	while (1)
+	{
+		timer_wheel_update();
+		
+		if(byte_received){
+			if(timer_wheel_restart(frame_timer, 20)!= TIMER_WHEEL_OK){
+				frame_timer= timer_wheel_add(20, frame_timeout);
+			}
+		}
+	}
+}
+
+*/
+
+#endif /* TIMERWHEEL_H_ */